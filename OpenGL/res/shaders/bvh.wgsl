@@ -0,0 +1,194 @@
+// Wall segments and their BVH, matching `Segment` and `BvhNode` in geometry/BVH.h.
+// The including shader has to bind `segments : array<Segment>` and `bvhNodes : array<BvhNode>`.
+
+struct Segment {
+    start : vec2<f32>,
+    end   : vec2<f32>,
+};
+
+struct BvhNode {
+    leftTypeCount : u32,    // leftType :1, leftCount :31
+    leftOffset    : u32,
+
+    rightTypeCount : u32,   // rightType :1, rightCount :31
+    rightOffset    : u32,
+
+    leftBBoxMin  : vec2<f32>,
+    leftBBoxMax  : vec2<f32>,
+
+    rightBBoxMin : vec2<f32>,
+    rightBBoxMax : vec2<f32>,
+};
+
+struct AABB {
+    min : vec2<f32>,
+    max : vec2<f32>,
+};
+
+// Helper functions to unpack BVH Node data
+fn getLeftType(node : BvhNode) -> u32 {
+    return node.leftTypeCount >> 31u;
+}
+
+fn getLeftCount(node : BvhNode) -> u32 {
+    return node.leftTypeCount & 0x7FFFFFFFu;
+}
+
+fn getRightType(node : BvhNode) -> u32 {
+    return node.rightTypeCount >> 31u;
+}
+
+fn getRightCount(node : BvhNode) -> u32 {
+    return node.rightTypeCount & 0x7FFFFFFFu;
+}
+
+fn hasRightChild(node : BvhNode) -> bool {
+    return any(node.rightBBoxMin != vec2<f32>(0.0)) || any(node.rightBBoxMax != vec2<f32>(0.0));
+}
+
+// Utility functions
+fn cross2D(a : vec2<f32>, b : vec2<f32>) -> f32 {
+    return a.x * b.y - a.y * b.x;
+}
+
+fn dot2D(a : vec2<f32>, b : vec2<f32>) -> f32 {
+    return a.x * b.x + a.y * b.y;
+}
+
+struct SegmentIntersection {
+    hit      : bool,
+    position : vec2<f32>,
+    normal   : vec2<f32>,
+    t        : f32,         // along the path
+};
+
+// Intersection of a path with a wall, with t along the path
+fn segmentIntersection(path : Segment, wall : Segment) -> SegmentIntersection {
+    var result : SegmentIntersection;
+    result.hit = false;
+
+    let p = path.start;
+    let r = path.end - path.start;
+    let q = wall.start;
+    let s = wall.end - wall.start;
+
+    let r_cross_s = cross2D(r, s);
+    let q_p = q - p;
+
+    if (abs(r_cross_s) < 1e-8) {
+        return result; // Lines are parallel
+    }
+
+    let t = cross2D(q_p, s) / r_cross_s;
+    let u = cross2D(q_p, r) / r_cross_s;
+
+    if (t >= 0.0 && t <= 1.0 && u >= 0.0 && u <= 1.0) {
+        result.hit = true;
+        result.t = t;
+        result.position = p + t * r;
+        result.normal = normalize(vec2<f32>(-s.y, s.x)); // Perpendicular to wall
+    }
+
+    return result;
+}
+
+// Where origin + t * direction enters the box for t in [0, 1], or -1 if it misses
+fn bvhEntryT(origin : vec2<f32>, inverseDirection : vec2<f32>, box : AABB) -> f32 {
+    let t0 = (box.min - origin) * inverseDirection;
+    let t1 = (box.max - origin) * inverseDirection;
+    let near = min(t0, t1);
+    let far = max(t0, t1);
+    let tmin = max(max(near.x, near.y), 0.0);
+    let tmax = min(min(far.x, far.y), 1.0);
+    return select(-1.0, tmin, tmin <= tmax);
+}
+
+const BVH_STACK_SIZE : u32 = 64u; // BVH_STACK_SIZE in geometry/BVH.h
+
+// Tests the segments of a bucket against the path, keeping the closest hit
+fn bvhTestBucket(path : Segment, offset : u32, count : u32, closest : ptr<function, SegmentIntersection>) {
+    for (var i : u32 = 0u; i < count; i++) {
+        let intersection = segmentIntersection(path, segments[offset + i]);
+        if (intersection.hit && intersection.t < (*closest).t) {
+            *closest = intersection;
+        }
+    }
+}
+
+// Closest wall hit along the path. Walks the BVH with a fixed stack, nearer child first, skipping children that
+// start further along the path than the closest hit so far.
+fn findWallCollision(start : vec2<f32>, end : vec2<f32>) -> SegmentIntersection {
+    var closest : SegmentIntersection;
+    closest.hit = false;
+    closest.t = 999999.0;
+
+    let nodeCount = arrayLength(&bvhNodes);
+    if (nodeCount == 0u) {
+        return closest;
+    }
+
+    let path = Segment(start, end);
+    let direction = end - start;
+    // Nudge zero direction components so the slab test never divides by zero
+    let inverseDirection = 1.0 / select(direction, vec2<f32>(1e-8), abs(direction) < vec2<f32>(1e-8));
+
+    var stackNode : array<u32, BVH_STACK_SIZE>;
+    var stackT : array<f32, BVH_STACK_SIZE>;
+    var stackSize : u32 = 1u;
+    stackNode[0] = nodeCount - 1u; // Root node
+    stackT[0] = 0.0;
+
+    while (stackSize > 0u) {
+        stackSize -= 1u;
+        if (stackT[stackSize] >= closest.t) {
+            continue; // Everything in here is further away than what we already hit
+        }
+        let node = bvhNodes[stackNode[stackSize]];
+
+        var leftT = bvhEntryT(start, inverseDirection, AABB(node.leftBBoxMin, node.leftBBoxMax));
+        var rightT = -1.0;
+        if (hasRightChild(node)) {
+            rightT = bvhEntryT(start, inverseDirection, AABB(node.rightBBoxMin, node.rightBBoxMax));
+        }
+
+        // Order the children nearest first
+        var nearType = getLeftType(node);
+        var nearCount = getLeftCount(node);
+        var nearOffset = node.leftOffset;
+        var nearT = leftT;
+        var farType = getRightType(node);
+        var farCount = getRightCount(node);
+        var farOffset = node.rightOffset;
+        var farT = rightT;
+        if (rightT >= 0.0 && (leftT < 0.0 || rightT < leftT)) {
+            nearType = farType;
+            nearCount = farCount;
+            nearOffset = farOffset;
+            nearT = rightT;
+            farType = getLeftType(node);
+            farCount = getLeftCount(node);
+            farOffset = node.leftOffset;
+            farT = leftT;
+        }
+
+        // Buckets are tested right away, nodes are pushed far first so the near one is popped first
+        if (nearType == 1u && nearT >= 0.0 && nearT < closest.t) {
+            bvhTestBucket(path, nearOffset, nearCount, &closest);
+        }
+        if (farType == 1u && farT >= 0.0 && farT < closest.t) {
+            bvhTestBucket(path, farOffset, farCount, &closest);
+        }
+        if (farType == 0u && farT >= 0.0 && farT < closest.t && stackSize < BVH_STACK_SIZE) {
+            stackNode[stackSize] = farOffset;
+            stackT[stackSize] = farT;
+            stackSize += 1u;
+        }
+        if (nearType == 0u && nearT >= 0.0 && nearT < closest.t && stackSize < BVH_STACK_SIZE) {
+            stackNode[stackSize] = nearOffset;
+            stackT[stackSize] = nearT;
+            stackSize += 1u;
+        }
+    }
+
+    return closest;
+}
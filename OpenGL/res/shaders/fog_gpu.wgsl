@@ -0,0 +1,49 @@
+// Fog drawn over the open area of the map (everything inside the walls' hull that isn't a wall). Each fragment is
+// lit when the straight line from the player reaches it without crossing a wall, so the visibility polygon never has
+// to be built on the CPU.
+
+#include <bvh.wgsl>
+
+struct VertexUniforms {
+    u_MVP: mat4x4<f32>
+};
+
+struct FragmentUniforms {
+    u_Color: vec4<f32>,
+    u_BandColor: vec4<f32>,
+    uPlayerPosition: vec2<f32>,
+};
+
+@group(0) @binding(0) var<uniform> fogVertexUniforms: VertexUniforms;
+@group(0) @binding(1) var<uniform> fogFragmentUniforms: FragmentUniforms;
+@group(0) @binding(2) var<storage, read> segments : array<Segment>;
+@group(0) @binding(3) var<storage, read> bvhNodes : array<BvhNode>;
+
+struct VertexInput {
+    @location(0) position: vec2<f32>
+};
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) vWorldPosition: vec2<f32>,
+};
+
+@vertex
+fn vertex_main(input: VertexInput) -> VertexOutput {
+    var output: VertexOutput;
+    output.position = fogVertexUniforms.u_MVP * vec4<f32>(input.position, 0.0, 1.0);
+    output.vWorldPosition = input.position;
+    return output;
+}
+
+@fragment
+fn fragment_main(@location(0) vWorldPosition: vec2<f32>) -> @location(0) vec4<f32> {
+    if (!findWallCollision(fogFragmentUniforms.uPlayerPosition, vWorldPosition).hit) {
+        discard; // The player can see this point
+    }
+
+    // Same falloff as fog.wgsl
+    let distance = length(vWorldPosition - fogFragmentUniforms.uPlayerPosition);
+    let intensity = 1.0 / (1.0 + ((distance * distance) / 15.0));
+    return mix(fogFragmentUniforms.u_Color, fogFragmentUniforms.u_BandColor, intensity);
+}
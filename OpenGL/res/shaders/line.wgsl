@@ -1,9 +1,9 @@
+// Debug lines, drawn together with one instance per line (LineInstance in DataFormats.h)
+
 // Vertex Uniforms
 struct VertexUniforms {
-    u_StartPos: vec2<f32>,
-    u_EndPos: vec2<f32>,
+    u_VP: mat4x4<f32>,
     u_Width: f32,
-    u_MVP: mat4x4<f32>,
 };
 
 @group(0) @binding(0)
@@ -14,18 +14,26 @@ struct VertexInput {
     @location(0) a_Position: vec2<f32>,
 };
 
+// Instance Input Structure
+struct InstanceInput {
+    @location(1) startPos: vec2<f32>,
+    @location(2) endPos: vec2<f32>,
+    @location(3) color: vec4<f32>,
+};
+
 // Vertex Output Structure
 struct VertexOutput {
     @builtin(position) Position: vec4<f32>,
+    @location(0) v_Color: vec4<f32>,
 };
 
 // Vertex Shader Entry Point
 @vertex
-fn vertex_main(input: VertexInput) -> VertexOutput {
+fn vertex_main(input: VertexInput, instance: InstanceInput) -> VertexOutput {
     var output: VertexOutput;
 
     // Calculate the direction vector from start to end
-    let direction = normalize(vertexUniforms.u_EndPos - vertexUniforms.u_StartPos);
+    let direction = normalize(instance.endPos - instance.startPos);
 
     // Calculate the perpendicular vector for width offset
     let perpendicular = vec2<f32>(-direction.y, direction.x);
@@ -34,25 +42,18 @@ fn vertex_main(input: VertexInput) -> VertexOutput {
     let offset = perpendicular * input.a_Position.y * vertexUniforms.u_Width;
 
     // Interpolate between start and end positions based on vertex x position
-    let interpolatedPos = mix(vertexUniforms.u_StartPos, vertexUniforms.u_EndPos, input.a_Position.x);
+    let interpolatedPos = mix(instance.startPos, instance.endPos, input.a_Position.x);
 
     // Apply the offset to get the final position
     let finalPos = interpolatedPos + offset;
 
-    // Transform the final position using the MVP matrix
-    output.Position = vertexUniforms.u_MVP * vec4<f32>(finalPos, 0.0, 1.0);
+    // Transform the final position using the view projection matrix
+    output.Position = vertexUniforms.u_VP * vec4<f32>(finalPos, 0.0, 1.0);
+    output.v_Color = instance.color;
 
     return output;
 }
 
-// Fragment Uniforms
-struct FragmentUniforms {
-    u_Color: vec4<f32>,
-};
-
-@group(0) @binding(1)
-var<uniform> fragmentUniforms: FragmentUniforms;
-
 // Fragment Output Structure
 struct FragmentOutput {
     @location(0) color: vec4<f32>,
@@ -60,8 +61,8 @@ struct FragmentOutput {
 
 // Fragment Shader Entry Point
 @fragment
-fn fragment_main() -> FragmentOutput {
+fn fragment_main(input: VertexOutput) -> FragmentOutput {
     var output: FragmentOutput;
-    output.color = fragmentUniforms.u_Color;
+    output.color = input.v_Color;
     return output;
 }
@@ -10,114 +10,54 @@ struct Particle {
     lifetime : f32,
 };
 
-struct Segment {
-    start : vec2<f32>,
-    end   : vec2<f32>,
+struct ParticleCounters {
+    indexCount     : u32,           // drawIndexedIndirect arguments
+    instanceCount  : atomic<u32>,   // Live particles, at the front of the particle buffer
+    firstIndex     : u32,
+    baseVertex     : i32,
+    firstInstance  : u32,
+    simulatedCount : u32,           // Live particles before the last compaction
 };
 
-struct BvhNode {
-    leftTypeCount : u32,    // leftType :1, leftCount :31
-    leftOffset    : u32,
-
-    rightTypeCount : u32,   // rightType :1, rightCount :31
-    rightOffset    : u32,
-
-    leftBBoxMin  : vec2<f32>,
-    leftBBoxMax  : vec2<f32>,
-
-    rightBBoxMin : vec2<f32>,
-    rightBBoxMax : vec2<f32>,
-};
-
-struct AABB {
-    min : vec2<f32>,
-    max : vec2<f32>,
-};
-
-// Helper functions to unpack BVH Node data
-fn getLeftType(node : BvhNode) -> u32 {
-    return node.leftTypeCount >> 31u;
-}
-
-fn getLeftCount(node : BvhNode) -> u32 {
-    return node.leftTypeCount & 0x7FFFFFFFu;
-}
-
-fn getRightType(node : BvhNode) -> u32 {
-    return node.rightTypeCount >> 31u;
-}
-
-fn getRightCount(node : BvhNode) -> u32 {
-    return node.rightTypeCount & 0x7FFFFFFFu;
-}
-
-fn isLeafNode(node : BvhNode, isLeft : bool) -> bool {
-    if isLeft {
-        return getLeftType(node) == 1u;
-    } else {
-        return getRightType(node) == 1u;
-    }
-}
-
-fn getChildOffset(node : BvhNode, isLeft : bool) -> u32 {
-    if isLeft {
-        return node.leftOffset;
-    } else {
-        return node.rightOffset;
-    }
-}
-
-fn getChildCount(node : BvhNode, isLeft : bool) -> u32 {
-    if isLeft {
-        return getLeftCount(node);
-    } else {
-        return getRightCount(node);
-    }
-}
-
-fn getChildBBox(node : BvhNode, isLeft : bool) -> AABB {
-    if isLeft {
-        return AABB(node.leftBBoxMin, node.leftBBoxMax);
-    } else {
-        return AABB(node.rightBBoxMin, node.rightBBoxMax);
-    }
-}
-
-// Utility functions
-fn cross2D(a : vec2<f32>, b : vec2<f32>) -> f32 {
-    return a.x * b.y - a.y * b.x;
-}
-
-fn dot2D(a : vec2<f32>, b : vec2<f32>) -> f32 {
-    return a.x * b.x + a.y * b.y;
-}
-
-struct Ray {
-    origin    : vec2<f32>,
-    direction : vec2<f32>,
+// ParticleEmitter in geometry/ParticleSimulation.h
+struct Emitter {
+    colorMin       : vec4<f32>,
+    colorMax       : vec4<f32>,
+    position       : vec2<f32>,
+    spread         : vec2<f32>,
+    velocity       : vec2<f32>,
+    speed          : f32,
+    lifetime       : f32,
+    lifetimeSpread : f32,
+    count          : u32,
+    seed           : u32,
 };
 
-struct SegmentIntersection {
-    hit      : bool,
-    position : vec2<f32>,
-    normal   : vec2<f32>,
-    t        : f32,
-};
+#include <bvh.wgsl>
 
 // Buffer bindings
 @group(0) @binding(0) var<storage, read_write> particleBuffer : array<Particle>;
 @group(0) @binding(1) var<uniform> world : WorldInfo;
 @group(0) @binding(2) var<storage, read> segments : array<Segment>;
 @group(0) @binding(3) var<storage, read> bvhNodes : array<BvhNode>;
+@group(0) @binding(4) var<storage, read_write> compactedBuffer : array<Particle>;
+@group(0) @binding(5) var<storage, read_write> scanOffsets : array<u32>;  // Live particles before this one in its block
+@group(0) @binding(6) var<storage, read_write> blockSums : array<u32>;    // Live particles in / before each block
+@group(0) @binding(7) var<storage, read_write> counters : ParticleCounters;
+@group(0) @binding(8) var<uniform> emitter : Emitter;
 
 // Constants
 const G : f32 = 30.0; 
 const MIN_DISTANCE_SQUARED : f32 = 1.0; // Prevent division by zero
+const WORKGROUP_SIZE : u32 = 256u;      // PARTICLE_WORKGROUP_SIZE in DataFormats.h
 
 // Compute shader entry point
-@compute @workgroup_size(256)
+@compute @workgroup_size(WORKGROUP_SIZE)
 fn compute_main(@builtin(global_invocation_id) id : vec3<u32>) {
     let index = id.x;
+    if (index >= atomicLoad(&counters.instanceCount)) {
+        return; // The dispatch is rounded up to whole workgroups, and the particles after the live ones are free slots
+    }
 
     let particle = &particleBuffer[index];
 
@@ -151,52 +91,136 @@ fn compute_main(@builtin(global_invocation_id) id : vec3<u32>) {
     particleBuffer[index].age += world.deltaTime;
 }
 
-fn findWallCollision(particlePosition : vec2<f32>, newPosition : vec2<f32>) -> SegmentIntersection {
-    var closest : SegmentIntersection;
-    closest.hit = false;
-    closest.t = 999999.0;
+// Emission
+// ========
+// One invocation per particle of the burst. Each one claims the next free slot after the live particles, bursts that
+// don't fit in the buffer are cut short.
 
-    let particlePath = Segment(particlePosition, newPosition);
-    
-    for (var i: u32 = 0; i < arrayLength(&segments); i++) {
-        let wall = segments[i];
-        let intersection = segmentIntersection(wall, particlePath);
-        
-        if (intersection.hit && intersection.t < closest.t) {
-            closest = intersection;
-        }
+fn pcgHash(value : u32) -> u32 {
+    let state = value * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Next random number in [0, 1), advancing `state`
+fn nextRandom(state : ptr<function, u32>) -> f32 {
+    *state = pcgHash(*state);
+    return f32(*state >> 8u) / 16777216.0;
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn emit(@builtin(global_invocation_id) id : vec3<u32>) {
+    let index = id.x;
+    if (index >= emitter.count) {
+        return;
     }
-    
-    return closest;
+    let slot = atomicAdd(&counters.instanceCount, 1u);
+    if (slot >= arrayLength(&particleBuffer)) {
+        atomicSub(&counters.instanceCount, 1u);
+        return; // The buffer is full
+    }
+
+    // Drawn in the same order as ParticleSimulation::emit
+    var random = pcgHash(emitter.seed + index * 0x9E3779B9u);
+    let offsetX = nextRandom(&random) * 2.0 - 1.0;
+    let offsetY = nextRandom(&random) * 2.0 - 1.0;
+    let jitterX = nextRandom(&random) - 0.5;
+    let jitterY = nextRandom(&random) - 0.5;
+    let scale = 1.0 + (nextRandom(&random) * 2.0 - 1.0) * emitter.lifetimeSpread;
+    let red = nextRandom(&random);
+    let green = nextRandom(&random);
+    let blue = nextRandom(&random);
+    let alpha = nextRandom(&random);
+
+    var particle : Particle;
+    particle.position = emitter.position + vec2<f32>(offsetX, offsetY) * emitter.spread;
+    particle.velocity = emitter.velocity + vec2<f32>(jitterX, jitterY) * emitter.speed;
+    particle.color = mix(emitter.colorMin, emitter.colorMax, vec4<f32>(red, green, blue, alpha));
+    particle.age = 0.0;
+    particle.lifetime = emitter.lifetime * scale;
+    particleBuffer[slot] = particle;
 }
 
-fn segmentIntersection(s1 : Segment, s2 : Segment) -> SegmentIntersection {
-    var result : SegmentIntersection;
-    result.hit = false;
-    
-    let p = s1.start;
-    let r = s1.end - s1.start;
-    let q = s2.start;
-    let s = s2.end - s2.start;
+// Compaction
+// ==========
+// After the particles move, the live ones (age < lifetime) are packed into compactedBuffer in their current order:
+// scan_blocks counts them per workgroup with a prefix sum, scan_block_sums turns the per-block counts into block
+// offsets and the new live count, and scatter copies every live particle to its offset. The slots after the live
+// particles are free for new ones, and the renderer draws `counters` indirectly, so nothing is read back.
+
+var<workgroup> scratch : array<u32, WORKGROUP_SIZE>;
 
-    let r_cross_s = cross2D(r, s);
-    let q_p = q - p;
+fn isAlive(index : u32, count : u32) -> bool {
+    if (index >= count) {
+        return false;
+    }
+    let particle = particleBuffer[index];
+    return particle.age < particle.lifetime;
+}
 
-    if (abs(r_cross_s) < 1e-8) {
-        return result; // Lines are parallel
+// Exclusive prefix sum of `value` over the workgroup (Hillis-Steele), with the workgroup total in y. Has to be called
+// from uniform control flow.
+fn workgroupScan(local : u32, value : u32) -> vec2<u32> {
+    scratch[local] = value;
+    workgroupBarrier();
+    for (var offset : u32 = 1u; offset < WORKGROUP_SIZE; offset <<= 1u) {
+        var sum = scratch[local];
+        if (local >= offset) {
+            sum += scratch[local - offset];
+        }
+        workgroupBarrier();
+        scratch[local] = sum;
+        workgroupBarrier();
     }
+    let inclusive = scratch[local];
+    let total = scratch[WORKGROUP_SIZE - 1u];
+    workgroupBarrier();
+    return vec2<u32>(inclusive - value, total);
+}
 
-    let t = cross2D(q_p, s) / r_cross_s;
-    let u = cross2D(q_p, r) / r_cross_s;
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scan_blocks(@builtin(global_invocation_id) id : vec3<u32>,
+               @builtin(local_invocation_id) local : vec3<u32>,
+               @builtin(workgroup_id) group : vec3<u32>) {
+    let index = id.x;
+    let scan = workgroupScan(local.x, select(0u, 1u, isAlive(index, atomicLoad(&counters.instanceCount))));
+    if (index < arrayLength(&scanOffsets)) {
+        scanOffsets[index] = scan.x;
+    }
+    if (local.x == 0u) {
+        blockSums[group.x] = scan.y;
+    }
+}
 
-    if (t >= 0.0 && t <= 1.0 && u >= 0.0 && u <= 1.0) {
-        result.hit = true;
-        result.t = t;
-        result.position = p + t * r;
-        result.normal = normalize(vec2<f32>(-r.y, r.x)); // Perpendicular to wall
-        return result;
+// Runs as a single workgroup, walking the block counts WORKGROUP_SIZE at a time
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scan_block_sums(@builtin(local_invocation_id) local : vec3<u32>) {
+    let blockCount = arrayLength(&blockSums);
+    var carry : u32 = 0u;
+    for (var first : u32 = 0u; first < blockCount; first += WORKGROUP_SIZE) {
+        let block = first + local.x;
+        var count : u32 = 0u;
+        if (block < blockCount) {
+            count = blockSums[block];
+        }
+        let scan = workgroupScan(local.x, count);
+        if (block < blockCount) {
+            blockSums[block] = carry + scan.x;
+        }
+        carry += scan.y;
     }
 
-    return result;
+    if (local.x == 0u) {
+        counters.simulatedCount = atomicLoad(&counters.instanceCount);
+        atomicStore(&counters.instanceCount, carry);
+    }
 }
 
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scatter(@builtin(global_invocation_id) id : vec3<u32>, @builtin(workgroup_id) group : vec3<u32>) {
+    let index = id.x;
+    if (!isAlive(index, counters.simulatedCount)) {
+        return;
+    }
+    compactedBuffer[blockSums[group.x] + scanOffsets[index]] = particleBuffer[index];
+}
@@ -1,25 +1,32 @@
+// Sprites drawn by SpriteBatch, one instance per SquareObject
+
 // Vertex Uniforms
 struct VertexUniforms {
-    u_MVP: mat4x4<f32>
-};
-
-// Fragment Uniforms
-struct FragmentUniforms {
-    u_Color: vec4<f32>,
-    u_Opacity: f32,
+    u_VP: mat4x4<f32>
 };
 
-
 // Vertex Input Structure
 struct VertexInput {
     @location(0) position: vec2<f32>,
     @location(1) texCoord: vec2<f32>,
 };
 
+// Instance Input Structure, SpriteInstance in DataFormats.h
+struct InstanceInput {
+    @location(2) axisX: vec2<f32>,
+    @location(3) axisY: vec2<f32>,
+    @location(4) translation: vec2<f32>,
+    @location(5) tint: vec4<f32>,
+    @location(6) opacity: f32,
+    @location(7) textureRect: vec4<f32>,  // UV offset and size in the texture atlas
+};
+
 // Vertex Output Structure
 struct VertexOutput {
     @builtin(position) Position: vec4<f32>,
     @location(0) v_TexCoord: vec2<f32>,
+    @location(1) v_Tint: vec4<f32>,
+    @location(2) v_Opacity: f32,
 };
 
 // Fragment Output Structure
@@ -31,22 +38,22 @@ struct FragmentOutput {
 var<uniform> vertexUniforms: VertexUniforms;
 
 @group(0) @binding(1)
-var<uniform> fragmentUniforms: FragmentUniforms;
-
-@group(0) @binding(2)
 var u_Texture: texture_2d<f32>;
 
-@group(0) @binding(3)
+@group(0) @binding(2)
 var u_Sampler: sampler;
 
 // Vertex Shader Entry Point
 @vertex
-fn vertex_main(input: VertexInput) -> VertexOutput {
+fn vertex_main(input: VertexInput, instance: InstanceInput) -> VertexOutput {
     var output: VertexOutput;
-    // Transform the vertex position
-    output.Position = vertexUniforms.u_MVP * vec4<f32>(input.position, 0.0, 1.0);
-    // Pass through the texture coordinate
-    output.v_TexCoord = input.texCoord;
+    // Transform the vertex position with the instance's world transform
+    let worldPosition = instance.axisX * input.position.x + instance.axisY * input.position.y + instance.translation;
+    output.Position = vertexUniforms.u_VP * vec4<f32>(worldPosition, 0.0, 1.0);
+    // Map the texture coordinate into the sprite's part of the atlas and pass through the instance's colors
+    output.v_TexCoord = instance.textureRect.xy + input.texCoord * instance.textureRect.zw;
+    output.v_Tint = instance.tint;
+    output.v_Opacity = instance.opacity;
     return output;
 }
 
@@ -56,10 +63,10 @@ fn fragment_main(input: VertexOutput) -> FragmentOutput {
     var output: FragmentOutput;
     // Sample the texture color
     let texColor = textureSample(u_Texture, u_Sampler, input.v_TexCoord);
-    // Mix the texture color with the uniform color based on the alpha value of u_Color
-    let mixedColor = mix(texColor, fragmentUniforms.u_Color, fragmentUniforms.u_Color.a);
+    // Mix the texture color with the tint based on the alpha value of the tint
+    let mixedColor = mix(texColor, input.v_Tint, input.v_Tint.a);
     // Set the final color, preserving the alpha from the texture
     output.color = vec4<f32>(mixedColor.rgb, texColor.a);
-    output.color.a *= fragmentUniforms.u_Opacity;
+    output.color.a *= input.v_Opacity;
     return output;
 }
@@ -49,6 +49,7 @@
 #include "game_objects/SquareObject.h"
 #include "game_objects/Tile.h"
 #include "game_objects/Fog.h"
+#include "game_objects/ParticleSystem.h"
 #include "World.h"
 
 // TODO: Not emscripten friendly, see https://github.com/ocornut/imgui/blob/master/examples/example_glfw_wgpu/main.cpp
@@ -132,6 +133,29 @@ void mainLoop(Application& application, Renderer& renderer) {
                ImGui::Begin("Performance Info");
                ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / application.getImGuiIO().Framerate,
                            application.getImGuiIO().Framerate);
+               const auto& walls = World::getWalls();
+               ImGui::Text("Walls: %zu segments, %zu BVH nodes", walls.bvh.segments.size(), walls.bvh.nodes.size());
+               ImGui::Text("Particles: %zu slots, %zu bursts this frame", World::particles().getCapacity(),
+                           World::particles().getEmittersThisFrame());
+               ImGui::Checkbox("Simulate particles on CPU", &ParticleSystem::simulateOnCpu);
+               ImGui::Checkbox("Fog visibility on GPU", &Fog::gpuVisibility);
+               ImGui::Text("Draw calls: %zu (%zu sprites, %zu debug lines)", renderPass.getDrawCalls(),
+                           renderer.sprites.getSpritesThisFrame(), renderer.getLinesThisFrame());
+               ImGui::Text("Objects: %zu drawn, %zu culled (tiles are drawn as chunks)", World::objectsDrawn,
+                           World::objectsCulled);
+               ImGui::Text("Queue writes: %zu last frame", StagedWrites::lastFrameWrites);
+               ImGui::Text("Buffer pool: %zu hits, %zu misses last frame, %zu free", BufferPool::lastFrameHits,
+                           BufferPool::lastFrameMisses, BufferPool::freeCount());
+               ImGui::Text("Tile chunks: %zu of %zu drawn", World::tileChunks.getChunksDrawn(),
+                           World::tileChunks.getChunkCount());
+               static bool timeTypeQueries = false;
+               ImGui::Checkbox("Time type queries", &timeTypeQueries);
+               if (timeTypeQueries) {
+                  auto timing = World::timeTypeQueries();
+                  ImGui::Text("getAll<Tile> over %zu objects: %.2f us (scan %.2f us)", timing.objects,
+                              timing.getAllRegistry, timing.getAllScan);
+                  ImGui::Text("getFirst<Player>: %.3f us (scan %.3f us)", timing.getFirstRegistry, timing.getFirstScan);
+               }
                ImGui::End();
                ImGui::PopFont();
             }
@@ -536,7 +560,7 @@ int main(void) {
       CommandEncoder encoder(application.getDevice());
       application.encoder = &encoder.get();
       World::LoadMap("SpaceShip.txt");
-      World::gameobjects.push_back(std::make_unique<Fog>());
+      World::add(std::make_unique<Fog>());
       application.encoder = nullptr;
    }
 
@@ -0,0 +1,78 @@
+// TypeRegistries.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Objects of each queried type (including subclasses) out of a set of objects derived from Base, maintained as
+// objects are added and removed. A type's list is created the first time the type is queried, from the objects there
+// are at that point, so type queries never have to scan every object with a dynamic_cast.
+template <typename Base>
+class TypeRegistries {
+public:
+   // Objects of type T, in the order they were added. `all` has to hold every object added so far.
+   template <typename T>
+   const std::vector<std::shared_ptr<Base>>& of(const std::vector<std::shared_ptr<Base>>& all) {
+      size_t index = typeIndex<T>();
+      if (index >= registries.size()) {
+         registries.resize(index + 1);
+      }
+      auto& registry = registries[index];
+      if (!registry) {
+         registry = std::make_unique<Registry>(
+            Registry{[](const Base& object) { return dynamic_cast<const T*>(&object) != nullptr; }, {}});
+         for (auto& object : all) {
+            if (registry->matches(*object)) {
+               registry->objects.push_back(object);
+            }
+         }
+      }
+      return registry->objects;
+   }
+
+   void add(const std::shared_ptr<Base>& object) {
+      for (auto& registry : registries) {
+         if (registry && registry->matches(*object)) {
+            registry->objects.push_back(object);
+         }
+      }
+   }
+
+   template <typename Predicate>
+   void removeIf(Predicate remove) {
+      for (auto& registry : registries) {
+         if (registry) {
+            std::erase_if(registry->objects, [&](const auto& object) { return remove(*object); });
+         }
+      }
+   }
+
+   // Empties every list, the types stay registered
+   void clear() {
+      for (auto& registry : registries) {
+         if (registry) {
+            registry->objects.clear();
+         }
+      }
+   }
+
+private:
+   struct Registry {
+      bool (*matches)(const Base&);
+      std::vector<std::shared_ptr<Base>> objects;
+   };
+
+   // Types are numbered in the order they are first queried, by any instance
+   template <typename T>
+   static size_t typeIndex() {
+      static const size_t index = typeCount++;
+      return index;
+   }
+   inline static size_t typeCount = 0;
+
+   // Indexed by typeIndex, null for types this instance wasn't queried for. The lists stay where they are when more
+   // types are added, so callers can query other types while going over one.
+   std::vector<std::unique_ptr<Registry>> registries;
+};
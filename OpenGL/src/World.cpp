@@ -1,14 +1,19 @@
 #include "World.h"
 
+#include <array>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
 
 #include "rendering/Renderer.h"
 #include "game_objects/Player.h"
 #include "game_objects/Background.h"
 #include "game_objects/Camera.h"
 #include "game_objects/Particles.h"
+#include "game_objects/ParticleSystem.h"
 #include "game_objects/Tile.h"
 #include "game_objects/enemies/Bomber.h"
 #include "game_objects/enemies/Turret.h"
@@ -24,6 +29,17 @@ bool                                     World::shouldTick       = false;
 
 void World::LoadMap(const std::filesystem::path& map_path) {
    gameobjects.clear();
+   positions.clear();
+   invalidateObjectList();
+   wallChunks.clear();
+   tileChunks.clear();
+   registries.clear();
+
+   if (!particleSystem) {
+      particleSystem = std::make_shared<ParticleSystem>("Particles", DrawPriority::Character);
+   }
+   particleSystem->clear();
+   gameobjects.push_back(particleSystem);
 
    std::filesystem::path map_path_full = Application::get().res_path / "maps" / map_path;
 
@@ -81,46 +97,190 @@ void World::LoadMap(const std::filesystem::path& map_path) {
          }
       }
    }
+
+   for (auto& gameobject : gameobjects) {
+      track(gameobject);
+   }
+}
+
+const SceneGeometry::WallResult& World::getWalls() {
+   if (wallChunks.dirty()) {
+      wallChunks.assemble();
+      wallsVersion++;
+   }
+   return wallChunks.result();
+}
+
+const SceneGeometry::OpenArea& World::getOpenArea() {
+   const auto& walls = getWalls();
+   if (!openArea || openAreaVersion != wallsVersion) {
+      openArea        = std::make_unique<SceneGeometry::OpenArea>(SceneGeometry::computeOpenArea(walls));
+      openAreaVersion = wallsVersion;
+   }
+   return *openArea;
+}
+
+World::QueryTiming World::timeTypeQueries() {
+   using Clock           = std::chrono::steady_clock;
+   constexpr int repeats = 100;
+   size_t        found   = 0;
+   auto          time    = [&](auto&& query) {
+      auto start = Clock::now();
+      for (int i = 0; i < repeats; i++) {
+         query();
+      }
+      return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+   };
+
+   QueryTiming timing{};
+   timing.objects        = gameobjects.size();
+   timing.getAllRegistry = time([&] { found += getAll<Tile>().size(); });
+   timing.getAllScan     = time([&] {
+      std::vector<Tile*> tiles;
+      for (auto& gameobject : gameobjects) {
+         if (auto tile = dynamic_cast<Tile*>(gameobject.get())) {
+            tiles.push_back(tile);
+         }
+      }
+      found += tiles.size();
+   });
+   timing.getFirstRegistry = time([&] { found += getFirst<Player>() != nullptr; });
+   timing.getFirstScan     = time([&] {
+      for (auto& gameobject : gameobjects) {
+         if (dynamic_cast<Player*>(gameobject.get())) {
+            found++;
+            break;
+         }
+      }
+   });
+
+   // Keeps the queries from being optimized away
+   static volatile size_t sink;
+   sink = found;
+   return timing;
+}
+
+void World::add(std::shared_ptr<GameObject> gameobject) {
+   gameobjects.push_back(std::move(gameobject));
+   track(gameobjects.back());
+   invalidateObjectList();
+}
+
+void World::track(const std::shared_ptr<GameObject>& gameobject) {
+   registries.add(gameobject);
+   addToPositions(gameobject);
+   if (auto tile = dynamic_cast<Tile*>(gameobject.get())) {
+      updateWall(tile->getTile(), tile->wall);
+      tileChunks.add(tile);
+   }
+}
+
+void World::addToPositions(const std::shared_ptr<GameObject>& gameobject) {
+   if (auto squareObject = dynamic_cast<SquareObject*>(gameobject.get())) {
+      positions[squareObject->getTile()].push_back(gameobject);
+   }
 }
 
-void sortGameObjectsByPriority(std::vector<std::unique_ptr<GameObject>>& gameObjects) {
-   std::sort(gameObjects.begin(), gameObjects.end(),
-             [](const std::unique_ptr<GameObject>& a, const std::unique_ptr<GameObject>& b) {
-                return a->drawPriority < b->drawPriority;
-             });
+void World::removeFromPositions(const GameObject& gameobject) {
+   if (auto squareObject = dynamic_cast<const SquareObject*>(&gameobject)) {
+      auto bucket = positions.find(squareObject->getTile());
+      if (bucket != positions.end()) {
+         std::erase_if(bucket->second, [&](const auto& other) { return other.get() == &gameobject; });
+         if (bucket->second.empty()) {
+            positions.erase(bucket);
+         }
+      }
+   }
 }
 
-void sortGameObjectsByPriority(std::vector<GameObject*>& gameObjects) {
-   std::sort(gameObjects.begin(), gameObjects.end(),
-             [](const GameObject* a, const GameObject* b) { return a->drawPriority < b->drawPriority; });
+void World::moveInPositions(const GameObject* gameobject, glm::ivec2 from, glm::ivec2 to) {
+   if (from == to) {
+      return;
+   }
+   auto bucket = positions.find(from);
+   if (bucket == positions.end()) {
+      return;
+   }
+   // Objects that aren't in the world yet (or are children of other objects) aren't indexed
+   auto& objects = bucket->second;
+   auto  it =
+      std::find_if(objects.begin(), objects.end(), [&](const auto& other) { return other.get() == gameobject; });
+   if (it == objects.end()) {
+      return;
+   }
+   auto moved = std::move(*it);
+   objects.erase(it);
+   if (objects.empty()) {
+      positions.erase(bucket);
+   }
+   positions[to].push_back(std::move(moved));
 }
 
+const std::vector<GameObject*>& World::get_sorted_gameobjects() {
+   if (!objectListDirty) {
+      return objectList;
+   }
+
+   // bucket by draw priority, keeping world order within each priority
+   static std::array<std::vector<GameObject*>, DrawPriorityCount> buckets;
+   for (auto& bucket : buckets) {
+      bucket.clear();
+   }
+   for (auto* gameobject : get_gameobjects()) {
+      buckets[static_cast<size_t>(gameobject->drawPriority)].push_back(gameobject);
+   }
+
+   objectList.clear();
+   renderList.clear();
+   for (size_t layer = 0; layer < DrawPriorityCount; layer++) {
+      objectList.insert(objectList.end(), buckets[layer].begin(), buckets[layer].end());
+      renderLayers[layer] = renderList.size();
+      std::copy_if(buckets[layer].begin(), buckets[layer].end(), std::back_inserter(renderList),
+                   [](GameObject* gameobject) { return !dynamic_cast<Tile*>(gameobject); });
+   }
+   renderLayers[DrawPriorityCount] = renderList.size();
+   objectListDirty                 = false;
+   return objectList;
+}
 
 void World::UpdateObjects() {
-   auto objects = get_gameobjects();
-   sortGameObjectsByPriority(objects);
+   auto& objects = get_sorted_gameobjects();
 
    for (auto& gameobject : objects) {
       gameobject->update();
       gameobject->progressCoroutines();
    }
 
-   for (auto& gameobject : objects) {}
-
    // erase dead objects
    // ------------------
-   std::erase_if(World::gameobjects, [](const auto& gameobject) { return gameobject->ShouldDestroy; });
+   bool anyDestroyed = false;
+   std::erase_if(World::gameobjects, [&](const auto& gameobject) {
+      if (gameobject->ShouldDestroy) {
+         removeFromPositions(*gameobject);
+         if (auto tile = dynamic_cast<Tile*>(gameobject.get())) {
+            updateWall(tile->getTile(), false);
+            tileChunks.remove(tile);
+         }
+         anyDestroyed = true;
+         return true;
+      }
+      return false;
+   });
+   if (anyDestroyed) {
+      invalidateObjectList();
+      registries.removeIf([](const GameObject& gameobject) { return gameobject.ShouldDestroy; });
+   }
 
    // add newly created objects
    // -------------------------
-   for (auto& o : World::gameobjectstoadd)
-      World::gameobjects.push_back(std::move(o));
+   for (auto& o : World::gameobjectstoadd) {
+      add(std::move(o));
+   }
    World::gameobjectstoadd.clear();
 }
 
 void World::TickObjects() {
-   auto objects = get_gameobjects();
-   sortGameObjectsByPriority(objects);
+   auto& objects = get_sorted_gameobjects();
 
    if (!ticksPaused()) {
       for (auto& gameobject : objects) {
@@ -130,17 +290,43 @@ void World::TickObjects() {
 }
 
 void World::RenderObjects(Renderer& renderer, RenderPass& renderPass) {
-   auto objects = get_gameobjects();
-   sortGameObjectsByPriority(objects);
+   get_sorted_gameobjects(); // Brings renderList up to date
 
-   for (auto& gameobject : objects) {
-      gameobject->render(renderer, renderPass);
+   // Sprites are batched per draw priority layer, so a layer's sprites are drawn before the next layer starts. Each
+   // layer starts with its tile chunks, tiles themselves aren't in renderList.
+   renderer.sprites.beginFrame();
+   tileChunks.beginFrame();
+   objectsDrawn  = 0;
+   objectsCulled = 0;
+
+   glm::vec4 viewBounds = CalculateViewBounds();
+   for (size_t layer = 0; layer < DrawPriorityCount; layer++) {
+      tileChunks.render(static_cast<DrawPriority>(layer), renderer, renderPass);
+      for (size_t i = renderLayers[layer]; i < renderLayers[layer + 1]; i++) {
+         if (!isVisible(*renderList[i], viewBounds)) {
+            objectsCulled++;
+            continue;
+         }
+         renderList[i]->render(renderer, renderPass);
+         objectsDrawn++;
+      }
+      renderer.sprites.flush(renderer, renderPass);
+   }
+}
+
+bool World::isVisible(const GameObject& gameobject, const glm::vec4& viewBounds) {
+   float radius = gameobject.getBoundingRadius();
+   if (std::isinf(radius)) {
+      return true;
    }
+   // Only children need their parents' transforms, the world position of everything else is its position
+   glm::vec2 center = gameobject.parent ? glm::vec2(gameobject.getWorldTransform()[3]) : gameobject.position;
+   return center.x + radius >= viewBounds.x && center.y + radius >= viewBounds.y &&
+          center.x - radius <= viewBounds.z && center.y - radius <= viewBounds.w;
 }
 
 void World::ComputeObjects(Renderer& renderer, ComputePass& computePass) {
-   auto objects = get_gameobjects();
-   sortGameObjectsByPriority(objects);
+   auto& objects = get_sorted_gameobjects();
 
    for (auto& gameobject : objects) {
       gameobject->compute(renderer, computePass);
@@ -148,8 +334,9 @@ void World::ComputeObjects(Renderer& renderer, ComputePass& computePass) {
 }
 
 void World::PreComputeObjects() {
-   auto objects = get_gameobjects();
-   sortGameObjectsByPriority(objects);
+   auto& objects = get_sorted_gameobjects();
+
+   tileChunks.sync();
 
    for (auto& gameobject : objects) {
       gameobject->pre_compute();
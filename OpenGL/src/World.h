@@ -1,11 +1,19 @@
 // World.h
 #pragma once
 
+#include <array>
+#include <cstdlib>
 #include <filesystem>
 #include <functional>
 
+#include "TypeRegistries.h"
 #include "game_objects/GameObject.h"
+#include "geometry/SceneGeometry.h"
+#include "geometry/WallChunks.h"
 #include "rendering/Renderer.h"
+#include "rendering/TileChunks.h"
+
+class ParticleSystem;
 
 class World {
 public:
@@ -13,7 +21,19 @@ public:
    static bool                                                                            settingTimeSpeed;
    static std::vector<std::shared_ptr<GameObject>>                                        gameobjects;
    static std::vector<std::unique_ptr<GameObject>>                                        gameobjectstoadd;
-   inline static std::unordered_map<glm::ivec2, std::vector<std::shared_ptr<GameObject>>> positions = {};
+   inline static std::unordered_map<glm::ivec2, std::vector<std::shared_ptr<GameObject>>> positions       = {};
+   inline static std::vector<GameObject*>                                                 objectList      = {};
+   inline static bool                                                                     objectListDirty = true;
+   inline static std::vector<GameObject*>                                                 renderList      = {};
+   inline static std::array<size_t, DrawPriorityCount + 1>                                renderLayers    = {};
+   inline static uint64_t                                                                 wallsVersion    = 0;
+   inline static WallChunks                                                               wallChunks      = {};
+   inline static std::unique_ptr<SceneGeometry::OpenArea>                                 openArea        = nullptr;
+   inline static uint64_t                                                                 openAreaVersion = 0;
+   inline static std::shared_ptr<ParticleSystem>                                          particleSystem  = nullptr;
+   inline static TileChunks                                                               tileChunks      = {};
+   inline static size_t                                                                   objectsDrawn    = 0;
+   inline static size_t                                                                   objectsCulled   = 0;
 
 
    static bool ticksPaused();
@@ -42,13 +62,24 @@ public:
       return allGameObjects;
    }
 
+   // All gameobjects and their children ordered by draw priority (stable within a priority). The list is kept
+   // across frames and only rebuilt after invalidateObjectList(), together with renderList: the same objects without
+   // the tiles tileChunks draws, where draw priority p starts at renderLayers[p].
+   static const std::vector<GameObject*>& get_sorted_gameobjects();
+
+   // Call when objects are added or destroyed, when children() changes, or when an object's drawPriority changes
+   static void invalidateObjectList() { objectListDirty = true; }
+
+   // Objects of each queried type (including subclasses), maintained as objects enter and leave the world
+   inline static TypeRegistries<GameObject> registries = {};
+
    template <typename T>
    static std::vector<std::shared_ptr<T>> where(std::function<bool(const T&)> condition) {
       std::vector<std::shared_ptr<T>> filteredObjects;
-      for (auto& gameobject : gameobjects) {
-         std::shared_ptr<T> castedObject = std::dynamic_pointer_cast<T>(gameobject);
-         if (castedObject && condition(*castedObject)) {
-            filteredObjects.push_back(castedObject);
+      for (auto& gameobject : registries.of<T>(gameobjects)) {
+         auto castedObject = std::static_pointer_cast<T>(gameobject);
+         if (condition(*castedObject)) {
+            filteredObjects.push_back(std::move(castedObject));
          }
       }
       return filteredObjects;
@@ -56,32 +87,85 @@ public:
 
    template <typename T>
    static std::vector<T*> getAll() {
+      auto&           objects = registries.of<T>(gameobjects);
       std::vector<T*> allObjects;
-      for (auto& gameobject : gameobjects) {
-         T* castedObject = dynamic_cast<T*>(gameobject.get());
-         if (castedObject) {
-            allObjects.push_back(castedObject);
-         }
+      allObjects.reserve(objects.size());
+      for (auto& gameobject : objects) {
+         allObjects.push_back(static_cast<T*>(gameobject.get()));
       }
       return allObjects;
    }
 
    template <typename T>
    static T* getFirst() {
-      for (auto& gameobject : gameobjects) {
-         T* castedObject = dynamic_cast<T*>(gameobject.get());
-         if (castedObject) {
-            return castedObject;
+      auto& objects = registries.of<T>(gameobjects);
+      return objects.empty() ? nullptr : static_cast<T*>(objects.front().get());
+   }
+
+   template <typename T>
+   static std::vector<std::shared_ptr<T>> at(int x, int y) {
+      std::vector<std::shared_ptr<T>> found;
+      auto                            bucket = positions.find({x, y});
+      if (bucket == positions.end()) {
+         return found;
+      }
+      for (auto& gameobject : bucket->second) {
+         if (auto castedObject = std::dynamic_pointer_cast<T>(gameobject)) {
+            found.push_back(castedObject);
          }
       }
-      return nullptr;
+      return found;
    }
 
+   // Objects of type T whose tile is less than `range` steps (Manhattan distance) away from `center`
    template <typename T>
-   static std::vector<std::shared_ptr<T>> at(int x, int y) {
-      return where<T>([&](const T& obj) { return obj.getTile().x == x && obj.getTile().y == y; });
+   static std::vector<std::shared_ptr<T>> within(glm::ivec2 center, int range) {
+      std::vector<std::shared_ptr<T>> found;
+      for (int dx = -range + 1; dx < range; ++dx) {
+         int span = range - 1 - std::abs(dx);
+         for (int dy = -span; dy <= span; ++dy) {
+            auto nearby = at<T>(center.x + dx, center.y + dy);
+            found.insert(found.end(), nearby.begin(), nearby.end());
+         }
+      }
+      return found;
    }
 
+   // Average cost of a few type queries through the registries, and of the dynamic_cast scans over every object they
+   // replaced, in microseconds. Shown in the Performance Info window.
+   struct QueryTiming {
+      size_t objects;
+      double getAllRegistry;
+      double getAllScan;
+      double getFirstRegistry;
+      double getFirstScan;
+   };
+   static QueryTiming timeTypeQueries();
+
+   // Wall geometry shared by fog, particles etc. Only the chunks touched by updateWall() are rebuilt, and
+   // `wallsVersion` changes with every rebuild so users can tell when derived data (e.g. GPU buffers) is stale.
+   static const SceneGeometry::WallResult& getWalls();
+   static void                             updateWall(glm::ivec2 tile, bool wall) { wallChunks.setWall(tile, wall); }
+
+   // Where fog can be, derived from getWalls() on first use after they changed
+   static const SceneGeometry::OpenArea& getOpenArea();
+
+   // The pool every particle emitter spawns into, created with the map
+   static ParticleSystem& particles() { return *particleSystem; }
+
+   // Adds an object to the world right away (use `gameobjectstoadd` while objects are being updated)
+   static void add(std::shared_ptr<GameObject> gameobject);
+
+   // Registry and spatial index maintenance for objects entering and leaving the world
+   static void track(const std::shared_ptr<GameObject>& gameobject);
+   static void addToPositions(const std::shared_ptr<GameObject>& gameobject);
+   static void removeFromPositions(const GameObject& gameobject);
+   static void          moveInPositions(const GameObject* gameobject, glm::ivec2 from, glm::ivec2 to);
+
+   // Whether the object's bounding circle overlaps `viewBounds` (see CalculateViewBounds). RenderObjects checks every
+   // object in renderList with it and counts the results in objectsDrawn / objectsCulled, tiles aren't included.
+   static bool isVisible(const GameObject& gameobject, const glm::vec4& viewBounds);
+
    static void LoadMap(const std::filesystem::path& map_path);
 
    static void UpdateObjects();
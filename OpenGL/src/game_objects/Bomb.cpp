@@ -21,17 +21,13 @@ void Bomb::tickUpdate() {
 }
 
 void Bomb::explode() {
-   auto nearbyWalls = World::where<Tile>([&](const Tile& tile) {
-      return (std::abs(getTile().x - tile.getTile().x) + std::abs(getTile().y - tile.getTile().y) < 3);
-   });
+   auto nearbyWalls = World::within<Tile>(getTile(), 3);
 
    for (auto wall : nearbyWalls) {
       wall->explode();
    }
 
-   auto nearbyCharacters = World::where<Character>([&](const Character& character) {
-      return (std::abs(getTile().x - character.getTile().x) + std::abs(getTile().y - character.getTile().y) < 3);
-   });
+   auto nearbyCharacters = World::within<Character>(getTile(), 3);
    for (auto character : nearbyCharacters) {
       character->hurt();
       std::cout << "bomb damaged " << character->name << ". their health is now " << character->health << std::endl;
@@ -10,6 +10,52 @@
 using namespace Clipper2Lib;
 using namespace GeometryUtils;
 
+namespace {
+
+// Triangulates every shaded region of the tree (and the regions inside its holes) into `vertices` / `indices`
+void triangulatePolyTree(const PolyTreeD& polytree, std::vector<FogVertex>& vertices, std::vector<uint32_t>& indices) {
+   for (auto& shadedRegion : polytree) {
+      std::vector<std::vector<PointD>> invisibility = {shadedRegion->Polygon()};
+      for (auto& holeRegion : *shadedRegion) {
+         invisibility.push_back(holeRegion->Polygon());
+         triangulatePolyTree(*holeRegion, vertices, indices);
+      }
+
+      // Triangulate the invisibility regions, earcut indexes into the points of this region only
+      auto firstVertex = static_cast<uint32_t>(vertices.size());
+      for (uint32_t index : mapbox::earcut<uint32_t>(invisibility)) {
+         indices.push_back(firstVertex + index);
+      }
+
+      // Collect vertices
+      for (const auto& shape : invisibility) {
+         for (const auto& point : shape) {
+            vertices.emplace_back(glm::vec2(point.x, point.y));
+         }
+      }
+   }
+}
+
+} // namespace
+
+Fog::Mesh::Mesh()
+   : vertexBuffer({}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex), "Fog Vertices")
+   , indexBuffer({}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index), "Fog Indices") {}
+
+void Fog::Mesh::build(const PolyTreeD& polytree) {
+   build(std::vector<const PolyTreeD*>{&polytree});
+}
+
+void Fog::Mesh::build(const std::vector<const PolyTreeD*>& polytrees) {
+   vertices.clear();
+   indices.clear();
+   for (const auto* polytree : polytrees) {
+      triangulatePolyTree(*polytree, vertices, indices);
+   }
+   vertexBuffer.upload(vertices);
+   indexBuffer.upload(indices);
+}
+
 Fog::Fog()
    : GameObject("Fog of War", DrawPriority::Fog, {0, 0})
    , vertexUniform(UniformBuffer<FogVertexUniform>(
@@ -17,7 +63,34 @@ Fog::Fog()
    , fragmentUniformWalls(
         UniformBufferView<FogFragmentUniform>::create(FogFragmentUniform(mainFogColor, tintFogColor, {0, 0})))
    , fragmentUniformOther(
-        UniformBufferView<FogFragmentUniform>::create(FogFragmentUniform(mainFogColor, mainFogColor, {0, 0}))) {}
+        UniformBufferView<FogFragmentUniform>::create(FogFragmentUniform(mainFogColor, mainFogColor, {0, 0})))
+   , segmentBuffer(
+        {}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage), "Fog Wall Segments")
+   , bvhBuffer({}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage), "Fog Wall BVH") {}
+
+void Fog::pre_compute() {
+   auto  player = World::getFirst<Player>(); // Simplified retrieval of the first player
+   auto& walls  = World::getWalls();
+
+   // The meshes are rebuilt (and uploaded outside of the render pass) only when the walls or the player moved
+   if (World::wallsVersion != meshWallsVersion) {
+      wallMesh.build(walls.wallPaths);
+   }
+   if (gpuVisibility) {
+      if (World::wallsVersion != openMeshWallsVersion) {
+         openMesh.build(*World::getOpenArea().tree);
+         segmentBuffer.upload(walls.bvh.segments);
+         bvhBuffer.upload(walls.bvh.nodes);
+         openMeshWallsVersion = World::wallsVersion;
+      }
+      meshPlayerPosition.reset(); // Not kept up to date, rebuild it if the CPU path is switched back on
+   } else if (World::wallsVersion != meshWallsVersion || meshPlayerPosition != player->position) {
+      auto visibility = SceneGeometry::computeVisibility(walls, World::getOpenArea(), player->position);
+      invisibilityMesh.build(*visibility.invisibilityPaths);
+      meshPlayerPosition = player->position;
+   }
+   meshWallsVersion = World::wallsVersion;
+}
 
 void Fog::render(Renderer& renderer, RenderPass& renderPass) {
    vertexUniform.upload({FogVertexUniform(MVP())});
@@ -27,46 +100,36 @@ void Fog::render(Renderer& renderer, RenderPass& renderPass) {
    fragmentUniformWalls.Update(FogFragmentUniform(mainFogColor, tintFogColor, player->position));
    fragmentUniformOther.Update(FogFragmentUniform(mainFogColor, mainFogColor, player->position));
 
-   auto walls      = SceneGeometry::computeWallPaths();
-   auto visibility = SceneGeometry::computeVisibility(walls, player->position);
-
    // Render the invisibility regions
-   renderPolyTree(renderer, renderPass, *visibility.invisibilityPaths, fragmentUniformOther);
-   renderPolyTree(renderer, renderPass, *walls.wallPaths, fragmentUniformWalls);
+   if (gpuVisibility) {
+      renderOpenMesh(renderer, renderPass);
+   } else {
+      renderMesh(renderer, renderPass, invisibilityMesh, fragmentUniformOther);
+   }
+   renderMesh(renderer, renderPass, wallMesh, fragmentUniformWalls);
 }
 
 void Fog::update() {}
 
-void Fog::renderPolyTree(Renderer& renderer, RenderPass& renderPass, const PolyTreeD& polytree,
-                         const UniformBufferView<FogFragmentUniform>& fragmentUniform) const {
-   for (auto& shadedRegion : polytree) {
-      std::vector<PointD>              shaded       = shadedRegion->Polygon();
-      std::vector<std::vector<PointD>> invisibility = {shaded};
-      for (auto& holeRegion : *shadedRegion) {
-         invisibility.push_back(holeRegion->Polygon());
-         renderPolyTree(renderer, renderPass, *holeRegion, fragmentUniform);
-      }
-
-      // Triangulate the invisibility regions
-      std::vector<uint16_t> indices = mapbox::earcut<uint16_t>(invisibility);
-
-      // Collect vertices
-      std::vector<FogVertex> vertices;
-      for (const auto& shape : invisibility) {
-         for (const auto& point : shape) {
-            vertices.emplace_back(glm::vec2(point.x, point.y));
-         }
-      }
+void Fog::renderMesh(Renderer& renderer, RenderPass& renderPass, Mesh& mesh,
+                     const UniformBufferView<FogFragmentUniform>& fragmentUniform) {
+   if (mesh.indices.empty()) {
+      return;
+   }
+   BindGroup bindGroup =
+      FogLayout::ToBindGroup(renderer.device, std::forward_as_tuple(vertexUniform, 0), fragmentUniform);
+   renderPass.Draw(renderer.fog, mesh.vertexBuffer, mesh.indexBuffer, bindGroup,
+                   {(unsigned int)fragmentUniform.getOffset()});
+}
 
-      // make vertex buffer
-      auto vertexBuffer =
-         Buffer<FogVertex>(vertices, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex));
-      // make index buffer
-      auto indexBuffer =
-         IndexBuffer(indices, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index));
-      // make bind group
-      BindGroup bindGroup =
-         FogLayout::ToBindGroup(renderer.device, std::forward_as_tuple(vertexUniform, 0), fragmentUniform);
-      renderPass.Draw(renderer.fog, vertexBuffer, indexBuffer, bindGroup, {(unsigned int)fragmentUniform.getOffset()});
+void Fog::renderOpenMesh(Renderer& renderer, RenderPass& renderPass) {
+   // Storage bindings can't be empty, and without walls there is no open area to cover anyway
+   if (openMesh.indices.empty() || bvhBuffer.count() == 0) {
+      return;
    }
+   BindGroup bindGroup = FogShadowLayout::ToBindGroup(renderer.device, std::forward_as_tuple(vertexUniform, 0),
+                                                      fragmentUniformOther, std::forward_as_tuple(segmentBuffer, 0),
+                                                      std::forward_as_tuple(bvhBuffer, 0));
+   renderPass.Draw(renderer.fogShadow, openMesh.vertexBuffer, openMesh.indexBuffer, bindGroup,
+                   {(unsigned int)fragmentUniformOther.getOffset()});
 }
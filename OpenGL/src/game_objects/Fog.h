@@ -7,18 +7,46 @@ class Fog : public GameObject {
 public:
    Fog();
    virtual void render(Renderer& renderer, RenderPass& renderPass) override;
+   virtual void pre_compute() override;
    virtual void update() override;
 
    glm::vec4 mainFogColor = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
    glm::vec4 tintFogColor = glm::vec4(0.1f, 0.1f, 0.1f, 0.0f);
 
+   // Test visibility per fragment against the wall BVH (fog_gpu.wgsl) instead of clipping the visibility polygon out
+   // of the fog on the CPU every time the player moves. The fog mesh then only changes with the walls.
+   inline static bool gpuVisibility = false;
+
 private:
-   virtual void renderPolyTree(Renderer& renderer, RenderPass& renderPass, const Clipper2Lib::PolyTreeD& polytree,
-                               const UniformBufferView<FogFragmentUniform>& fragmentUniform) const;
+   // All polygons of a fog layer triangulated into one mesh, kept on the GPU until the layer changes
+   struct Mesh {
+      Mesh();
 
+      void build(const Clipper2Lib::PolyTreeD& polytree);
+      void build(const std::vector<const Clipper2Lib::PolyTreeD*>& polytrees);
+
+      std::vector<FogVertex> vertices;
+      std::vector<uint32_t>  indices;
+      Buffer<FogVertex>      vertexBuffer;
+      IndexBuffer32          indexBuffer;
+   };
+
+   void renderMesh(Renderer& renderer, RenderPass& renderPass, Mesh& mesh,
+                   const UniformBufferView<FogFragmentUniform>& fragmentUniform);
+   void renderOpenMesh(Renderer& renderer, RenderPass& renderPass);
 
-private:
    UniformBuffer<FogVertexUniform>       vertexUniform;
    UniformBufferView<FogFragmentUniform> fragmentUniformWalls;
    UniformBufferView<FogFragmentUniform> fragmentUniformOther;
+
+   Mesh                     invisibilityMesh;
+   Mesh                     wallMesh;
+   std::optional<glm::vec2> meshPlayerPosition; // Where the invisibility mesh was built from
+   uint64_t                 meshWallsVersion = 0;
+
+   // GPU visibility: the whole open area is drawn, and the shader discards what the player can see
+   Mesh            openMesh;
+   Buffer<Segment> segmentBuffer;
+   Buffer<BvhNode> bvhBuffer;
+   uint64_t        openMeshWallsVersion = 0;
 };
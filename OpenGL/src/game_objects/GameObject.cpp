@@ -3,6 +3,7 @@
 #include "GameObject.h"
 #include "../Input.h"
 #include "Camera.h"
+#include "../World.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -20,6 +21,13 @@ void GameObject::render(Renderer& renderer, RenderPass& renderPass) {
    std::cout << "Rendering GameObject (you should not see this lol) " << name << std::endl;
 }
 
+void GameObject::setDrawPriority(DrawPriority priority) {
+   if (drawPriority != priority) {
+      drawPriority = priority;
+      World::invalidateObjectList();
+   }
+}
+
 void GameObject::pre_compute() {}
 void GameObject::compute(Renderer& renderer, ComputePass& computePass) {}
 
@@ -40,6 +48,13 @@ glm::mat4 GameObject::getLocalTransform() const {
    return CalculateModel(position, rotation, scale);
 }
 
+glm::mat4 GameObject::getWorldTransform() const {
+   if (parent) {
+      return parent->getWorldTransform() * getLocalTransform();
+   }
+   return getLocalTransform();
+}
+
 glm::mat4 GameObject::MVP() const {
    glm::mat4 localTransform = getLocalTransform();
 
@@ -4,6 +4,7 @@
 #include <string>
 #include <optional>
 #include <memory>
+#include <limits>
 #include "glm/glm.hpp"
 #include "../Generator.h"
 #include "../Input.h"
@@ -27,6 +28,8 @@ enum class DrawPriority {
    UI,
 };
 
+constexpr size_t DrawPriorityCount = static_cast<size_t>(DrawPriority::UI) + 1;
+
 class GameObject {
 public:
    GameObject(const std::string& name, DrawPriority drawPriority, glm::vec2 position);
@@ -43,6 +46,9 @@ public:
    virtual void tickUpdate();
    virtual void mini_talk(std::string text, std::string voice_selection);
 
+   // Changes drawPriority of an object that is already in the world
+   void setDrawPriority(DrawPriority priority);
+
    std::string  name;
    std::string  voice;
    DrawPriority drawPriority;
@@ -54,6 +60,13 @@ public:
    // Get this object's local transform matrix
    glm::mat4 getLocalTransform() const;
 
+   // Get this object's transform with its parents' transforms applied
+   glm::mat4 getWorldTransform() const;
+
+   // Radius around the world position of everything this object draws, used to skip rendering it when it is off
+   // screen. Infinite for objects that draw regardless of the camera.
+   virtual float getBoundingRadius() const { return std::numeric_limits<float>::infinity(); }
+
    // Get the Model-View-Projection matrix for this object
    glm::mat4 MVP() const;
 
@@ -12,9 +12,7 @@ Mine::Mine(const std::string& name, float x, float y)
 void Mine::tickUpdate() {
    // Explode the Mine
 
-   auto nearbyCharacters = World::where<Character>([&](const Character& character) {
-      return (std::abs(getTile().x - character.getTile().x) + std::abs(getTile().y - character.getTile().y) < 3);
-   });
+   auto nearbyCharacters = World::within<Character>(getTile(), 3);
    if (!nearbyCharacters.empty() || detectedCharacter) {
       detectedCharacter = true;
       ExplodeTick++;
@@ -0,0 +1,178 @@
+#include "ParticleSystem.h"
+#include "../Input.h"
+#include "../World.h"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t workgroupCount(size_t invocations) {
+   return static_cast<uint32_t>((invocations + PARTICLE_WORKGROUP_SIZE - 1) / PARTICLE_WORKGROUP_SIZE);
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem(const std::string& name, DrawPriority drawPriority, size_t capacity)
+   : GameObject(name, drawPriority, glm::vec2(0.0f))
+   , particles(std::vector<Particle>())
+   , scanOffsets(std::make_shared<Buffer<uint32_t>>(
+        std::vector<uint32_t>{}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage),
+        "Particle scan offsets"))
+   , blockSums(std::make_shared<Buffer<uint32_t>>(
+        std::vector<uint32_t>{}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage),
+        "Particle block sums"))
+   , counters(std::make_shared<Buffer<ParticleCounters>>(
+        std::vector<ParticleCounters>{ParticleCounters(0, 0)},
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage, wgpu::BufferUsage::Indirect),
+        "Particle counters"))
+   , pointBuffer(Buffer<ParticleVertex>::create(
+        {
+           ParticleVertex{glm::vec2(-0.5f, -0.5f) * (1.0f / 16.0f)}, // 0
+           ParticleVertex{glm::vec2(0.5f, -0.5f) * (1.0f / 16.0f)},  // 1
+           ParticleVertex{glm::vec2(0.5f, 0.5f) * (1.0f / 16.0f)},   // 2
+           ParticleVertex{glm::vec2(-0.5f, 0.5f) * (1.0f / 16.0f)},  // 3
+        },
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex)))
+   , indexBuffer(IndexBuffer::create(
+        {
+           0, 1, 2, // Triangle #0 connects points #0, #1 and #2
+           0, 2, 3  // Triangle #1 connects points #0, #2 and #3
+        },
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index)))
+   , segmentBuffer(std::make_shared<Buffer<Segment>>(
+        std::vector<Segment>{},
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopySrc, wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage),
+        "segments"))
+   , bvhBuffer(std::make_shared<Buffer<BvhNode>>(
+        std::vector<BvhNode>{},
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopySrc, wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Storage),
+        "bvh"))
+   , vertexUniform(UniformBufferView<ParticleVertexUniform>::create(ParticleVertexUniform{VP()}))
+   , worldInfo(UniformBufferView<ParticleWorldInfo>::create(ParticleWorldInfo(0.01f)))
+   , capacity(capacity) {
+   // Every slot exists from the start, live particles are packed at the front and the rest are free
+   particles.assign(capacity, Particle(glm::vec2(0.0f), glm::vec2(0.0f), glm::vec4(0.0f), 0.0f, 0.0f));
+   for (auto& buffer : particleBuffers) {
+      buffer = std::make_shared<Buffer<Particle>>(
+         particles,
+         wgpu::bothBufferUsages(wgpu::BufferUsage::Vertex, wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::CopySrc,
+                                wgpu::BufferUsage::Storage),
+         "Particles");
+   }
+   scanOffsets->upload(std::vector<uint32_t>(capacity, 0));
+   blockSums->upload(std::vector<uint32_t>(workgroupCount(capacity), 0));
+   counters->upload({ParticleCounters(indexBuffer->count(), 0)});
+   emitterUniforms.push_back(UniformBufferView<ParticleEmitter>::create(ParticleEmitter{}));
+}
+
+void ParticleSystem::render(Renderer& renderer, RenderPass& renderPass) {
+   // Update VP matrix
+   this->vertexUniform.Update(ParticleVertexUniform{VP()});
+
+   // Create bind group and draw the live particles, their count comes from the last compaction
+   BindGroup bindGroup = ParticleLayout::ToBindGroup(renderer.device, vertexUniform);
+   renderPass.DrawInstancedIndirect(renderer.particles, *indexBuffer, bindGroup, {(uint32_t)vertexUniform.getOffset()},
+                                    *counters, 0, *pointBuffer, *particleBuffers[currentBuffer]);
+}
+
+void ParticleSystem::pre_compute() {
+   auto& walls = World::getWalls();
+   if (uploadedWallsVersion != World::wallsVersion) {
+      bvhBuffer->upload(walls.bvh.nodes);
+      segmentBuffer->upload(walls.bvh.segments);
+      uploadedWallsVersion = World::wallsVersion;
+   }
+
+   if (simulateOnCpu) {
+      if (!steppedOnCpu) {
+         // The CPU copy is from before the switch to the GPU, those particles have moved on or died since
+         cpuState.clear();
+      }
+      emittersThisFrame = pendingEmitters.size();
+      for (const auto& emitter : pendingEmitters) {
+         ParticleSimulation::emit(cpuState, emitter, capacity);
+      }
+      pendingEmitters.clear();
+      ParticleSimulation::stepAll(cpuState, walls.bvh, Input::deltaTime);
+      ParticleSimulation::compact(cpuState);
+      uploadPending = true;
+   }
+   steppedOnCpu = simulateOnCpu;
+   if (uploadPending) {
+      uploadState();
+   }
+}
+
+void ParticleSystem::uploadState() {
+   for (size_t i = 0; i < cpuState.live; ++i) {
+      particles[i] = Particle(glm::vec2(cpuState.positionX[i], cpuState.positionY[i]),
+                              glm::vec2(cpuState.velocityX[i], cpuState.velocityY[i]), cpuState.color[i],
+                              cpuState.age[i], cpuState.lifetime[i]);
+   }
+   // Only the live particles, the counters tell the draw and the kernels where they end
+   particleBuffers[currentBuffer]->uploadRange(0, particles.data(), cpuState.live);
+   counters->upload({ParticleCounters(indexBuffer->count(), cpuState.live)});
+   uploadPending = false;
+}
+
+void ParticleSystem::compute(Renderer& renderer, ComputePass& computePass) {
+   if (simulateOnCpu) {
+      return; // Already stepped in pre_compute
+   }
+
+   // Every burst needs its own uniform, since they're all written before the pass runs
+   while (emitterUniforms.size() < pendingEmitters.size()) {
+      emitterUniforms.push_back(UniformBufferView<ParticleEmitter>::create(ParticleEmitter{}));
+   }
+   for (size_t i = 0; i < pendingEmitters.size(); ++i) {
+      emitterUniforms[i].Update(pendingEmitters[i]);
+   }
+
+   worldInfo.Update(ParticleWorldInfo(Input::deltaTime));
+   auto&     from      = *particleBuffers[currentBuffer];
+   auto&     to        = *particleBuffers[1 - currentBuffer];
+   BindGroup bindGroup = ParticleComputeLayout::ToBindGroup(
+      renderer.device, std::forward_as_tuple(from, 0), worldInfo, std::forward_as_tuple(*segmentBuffer, 0),
+      std::forward_as_tuple(*bvhBuffer, 0), std::forward_as_tuple(to, 0), std::forward_as_tuple(*scanOffsets, 0),
+      std::forward_as_tuple(*blockSums, 0), std::forward_as_tuple(*counters, 0), emitterUniforms[0]);
+
+   emittersThisFrame = pendingEmitters.size();
+   for (size_t i = 0; i < pendingEmitters.size(); ++i) {
+      computePass.dispatch(renderer.particlesEmit, bindGroup,
+                           {(uint32_t)worldInfo.getOffset(), (uint32_t)emitterUniforms[i].getOffset()},
+                           workgroupCount(std::min<size_t>(pendingEmitters[i].count, capacity)));
+   }
+   pendingEmitters.clear();
+
+   // One invocation per particle slot, the kernels skip the ones past the live count
+   std::vector<uint32_t> offsets{(uint32_t)worldInfo.getOffset(), (uint32_t)emitterUniforms[0].getOffset()};
+   uint32_t              workgroups = workgroupCount(capacity);
+   computePass.dispatch(renderer.particlesCompute, bindGroup, offsets, workgroups);
+   computePass.dispatch(renderer.particlesScanBlocks, bindGroup, offsets, workgroups);
+   computePass.dispatch(renderer.particlesScanBlockSums, bindGroup, offsets, 1);
+   computePass.dispatch(renderer.particlesScatter, bindGroup, offsets, workgroups);
+   currentBuffer = 1 - currentBuffer;
+}
+
+void ParticleSystem::emit(const ParticleEmitter& emitter) {
+   pendingEmitters.push_back(emitter);
+}
+
+void ParticleSystem::addParticle(const glm::vec2& pos, const glm::vec2& vel, const glm::vec4& color, float lifetime) {
+   // The emit kernel appends after the live particles in either mode, which a write to the CPU copy couldn't do while
+   // the GPU simulates
+   ParticleEmitter emitter;
+   emitter.colorMin = color;
+   emitter.colorMax = color;
+   emitter.position = pos;
+   emitter.velocity = vel;
+   emitter.lifetime = lifetime;
+   emitter.count    = 1;
+   emit(emitter);
+}
+
+void ParticleSystem::clear() {
+   pendingEmitters.clear();
+   cpuState.clear();
+   uploadPending = true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "GameObject.h"
+#include "../geometry/BVH.h"
+#include "../geometry/ParticleSimulation.h"
+#include "../rendering/Renderer.h"
+#include <glm/glm.hpp>
+#include <array>
+
+// Every particle in the world lives in this one pool: one pair of buffers, one set of compute dispatches and one
+// instanced draw per frame, with the wall BVH bound once. Emitters (see Particles) only queue bursts into it.
+class ParticleSystem : public GameObject {
+public:
+   static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+   ParticleSystem(const std::string& name, DrawPriority drawPriority, size_t capacity = DEFAULT_CAPACITY);
+   virtual void render(Renderer& renderer, RenderPass& renderPass) override;
+   virtual void pre_compute() override;
+   virtual void compute(Renderer& renderer, ComputePass& computePass) override;
+
+   // Spawns one particle on the next compute pass, as a burst of one
+   void addParticle(const glm::vec2& pos, const glm::vec2& vel, const glm::vec4& color, float lifetime);
+
+   // Spawns a burst of particles on the next compute pass. Only the emitter is uploaded, the particles are created by
+   // the emit kernel (or ParticleSimulation::emit on the CPU), and bursts are cut short when the pool is full.
+   void emit(const ParticleEmitter& emitter);
+
+   // Removes every particle and pending burst
+   void clear();
+
+   size_t getCapacity() const { return capacity; }
+   size_t getEmittersThisFrame() const { return emittersThisFrame; }
+
+   // Simulate on the CPU (ParticleSimulation) instead of running the compute shader. Switching to the GPU continues
+   // with the CPU's particles, switching to the CPU starts over without particles since the GPU's aren't read back.
+   inline static bool simulateOnCpu = false;
+
+private:
+   // Uploads the CPU copy of the particles and their live count, replacing what's on the GPU
+   void uploadState();
+
+   std::vector<Particle>                            particles; // Staging for uploads of cpuState, one per slot
+   ParticleState                                    cpuState;
+   bool                                             uploadPending = false;
+   bool                                             steppedOnCpu  = false; // Last frame
+   std::vector<ParticleEmitter>                     pendingEmitters;
+   size_t                                           emittersThisFrame = 0;
+   std::vector<UniformBufferView<ParticleEmitter>>  emitterUniforms;
+   std::array<std::shared_ptr<Buffer<Particle>>, 2> particleBuffers; // Simulated in one, compacted into the other
+   size_t                                           currentBuffer = 0;
+   std::shared_ptr<Buffer<uint32_t>>                scanOffsets;
+   std::shared_ptr<Buffer<uint32_t>>                blockSums;
+   std::shared_ptr<Buffer<ParticleCounters>>        counters;
+   std::shared_ptr<Buffer<ParticleVertex>>          pointBuffer;
+   std::shared_ptr<IndexBuffer>                     indexBuffer;
+   std::shared_ptr<Buffer<Segment>>                 segmentBuffer; // Re-uploaded when the walls change
+   std::shared_ptr<Buffer<BvhNode>>                 bvhBuffer;
+   UniformBufferView<ParticleVertexUniform>         vertexUniform;
+   UniformBufferView<ParticleWorldInfo>             worldInfo;
+   size_t                                           capacity; // Slots in the particle buffers
+   uint64_t                                         uploadedWallsVersion = 0;
+};
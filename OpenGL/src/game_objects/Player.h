@@ -14,6 +14,8 @@ public:
    virtual void hurt() override;
    bool         second_step = false;
    virtual void render(Renderer& renderer, RenderPass& renderPass) override;
+   // render() also handles the mouse, so the player is never culled
+   virtual float getBoundingRadius() const override { return std::numeric_limits<float>::infinity(); }
    bool         pauseTicks() { return kicking.has_value(); }
 
    std::unique_ptr<Text> healthText;
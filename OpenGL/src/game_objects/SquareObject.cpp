@@ -1,6 +1,7 @@
 #include "SquareObject.h"
 #include "../Input.h"
-#include "../rendering/Texture.h"
+#include "../rendering/TextureAtlas.h"
+#include "../World.h"
 
 SquareObject::SquareObject(const std::string& name, DrawPriority drawPriority, int tile_x, int tile_y,
                            std::string texturePath)
@@ -9,35 +10,27 @@ SquareObject::SquareObject(const std::string& name, DrawPriority drawPriority, i
                    tile_x, tile_y
 })
    , tilePosition({tile_x, tile_y})
-   , pointBuffer(Buffer<SquareObjectVertex>::create(
-        {
-           SquareObjectVertex{glm::vec2(-0.5f, -0.5f), glm::vec2(0.0f, 0.0f)}, // 0
-           SquareObjectVertex{glm::vec2(0.5f, -0.5f), glm::vec2(1.0f, 0.0f)},  // 1
-           SquareObjectVertex{glm::vec2(0.5f, 0.5f), glm::vec2(1.0f, 1.0f)},   // 2
-           SquareObjectVertex{glm::vec2(-0.5f, 0.5f), glm::vec2(0.0f, 1.0f)},  // 3
-        },
-        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex))),
-   indexBuffer(IndexBuffer::create(
-      {
-         0, 1, 2, // Triangle #0 connects points #0, #1 and #2
-         0, 2, 3  // Triangle #1 connects points #0, #2 and #3
-      },
-      wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index))),
-   vertexUniform(UniformBufferView<SquareObjectVertexUniform>::create(SquareObjectVertexUniform{MVP()})),
-   fragmentUniform(
-      UniformBufferView<SquareObjectFragmentUniform>::create(SquareObjectFragmentUniform(tintColor, opacity))),
-   texture(Texture::create(texturePath)) {}
+   , textureRect(TextureAtlas::get().region(texturePath)) {}
 
 void SquareObject::render(Renderer& renderer, RenderPass& renderPass) {
-   this->vertexUniform.Update(SquareObjectVertexUniform{MVP()});
-   this->fragmentUniform.Update(SquareObjectFragmentUniform(tintColor, opacity));
-   BindGroup bindGroup =
-      SquareObjectLayout::ToBindGroup(renderer.device, vertexUniform, fragmentUniform, texture.get(), renderer.sampler);
-   renderPass.Draw(renderer.squareObject, *pointBuffer, *indexBuffer, bindGroup,
-                   {
-                      (uint32_t)vertexUniform.getOffset(),
-                      (uint32_t)fragmentUniform.getOffset(),
-                   });
+   renderer.sprites.add(getSpriteInstance());
+}
+
+float SquareObject::getBoundingRadius() const {
+   // Half the longer diagonal of the unit quad, in world units (the diagonals differ once the quad is sheared)
+   glm::mat4 transform = getWorldTransform();
+   glm::vec2 x(transform[0]);
+   glm::vec2 y(transform[1]);
+   return 0.5f * std::max(glm::length(x + y), glm::length(x - y));
+}
+
+SpriteInstance SquareObject::getSpriteInstance() const {
+   return SpriteInstance(getWorldTransform(), tintColor, opacity, textureRect);
+}
+
+void SquareObject::setTile(glm::ivec2 position) {
+   World::moveInPositions(this, tilePosition, position);
+   tilePosition = position;
 }
 
 void SquareObject::update() {
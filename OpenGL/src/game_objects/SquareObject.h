@@ -1,7 +1,7 @@
 #pragma once
 #include "GameObject.h"
 #include "../rendering/Renderer.h"
-#include "../rendering/Texture.h"
+#include "../rendering/TextureAtlas.h"
 #include <glm/glm.hpp>
 
 class SquareObject : public GameObject {
@@ -12,17 +12,17 @@ public:
    glm::vec4    tintColor = glm::vec4(0.0f);
    float        opacity   = 1;
 
-   void       setTile(glm::ivec2 position) { tilePosition = position; }
+   virtual float getBoundingRadius() const override;
+
+   // The sprite this object draws this frame
+   SpriteInstance getSpriteInstance() const;
+
+   void       setTile(glm::ivec2 position);
    glm::ivec2 getTile() const { return tilePosition; }
 
 private:
    glm::ivec2 tilePosition;
 
-   std::shared_ptr<Buffer<SquareObjectVertex>> pointBuffer;
-   std::shared_ptr<IndexBuffer>                indexBuffer;
-   BufferView<SquareObjectVertexUniform>       vertexUniform;
-   BufferView<SquareObjectFragmentUniform>     fragmentUniform;
-
 protected:
-   std::shared_ptr<Texture> texture;
+   glm::vec4 textureRect; // See TextureAtlas::region
 };
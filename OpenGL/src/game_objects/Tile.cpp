@@ -1,12 +1,14 @@
 #include "Tile.h"
+#include "../World.h"
 
 Tile::Tile(const std::string& name, bool wall, bool unbreakable, float x, float y)
    : SquareObject(name, wall ? DrawPriority::Wall : DrawPriority::Floor, x, y, "alt-wall-bright.png")
    , wall(wall)
    , unbreakable(unbreakable)
-   , wallTexture(Texture::create("alt-wall-bright.png"))
-   , wallTextureUnbreakable(Texture::create("alt-wall-unbreakable.png"))
-   , floorTexture(Texture::create(std::vector<std::string>{"2-alt-floor.png", "2-alt-floor-2.png"}[rand() % 2])) {
+   , wallTexture(TextureAtlas::get().region("alt-wall-bright.png"))
+   , wallTextureUnbreakable(TextureAtlas::get().region("alt-wall-unbreakable.png"))
+   , floorTexture(
+        TextureAtlas::get().region(std::vector<std::string>{"2-alt-floor.png", "2-alt-floor-2.png"}[rand() % 2])) {
    setTexture();
 
 }
@@ -18,7 +20,9 @@ void Tile::explode() {
    if (!unbreakable || !wall) {
       tintColor = {0.8, 0.5, 0.5, 0.9};
       wall      = false;
-      drawPriority = DrawPriority::Floor;
+      setDrawPriority(DrawPriority::Floor);
+      World::updateWall(getTile(), false);
+      World::tileChunks.update(this);
    }
 }
 
@@ -37,19 +41,28 @@ std::vector<glm::vec2> Tile::getBounds() {
 }
 
 
+void Tile::render(Renderer& renderer, RenderPass& renderPass) {
+   // Drawn with the rest of its chunk by World::tileChunks
+}
+
 void Tile::update() {
-   tintColor.a = zeno(tintColor.a, 0, 0.1);
+   auto previousTint    = tintColor;
+   auto previousTexture = textureRect;
+   tintColor.a          = zeno(tintColor.a, 0, 0.1);
    setTexture();
+   if (tintColor != previousTint || textureRect != previousTexture) {
+      World::tileChunks.update(this);
+   }
 }
 
 void Tile::setTexture() {
    if (wall) {
       if (unbreakable) {
-         texture = wallTextureUnbreakable;
+         textureRect = wallTextureUnbreakable;
       } else {
-         texture = wallTexture;
+         textureRect = wallTexture;
       }
    } else {
-      texture = floorTexture;
+      textureRect = floorTexture;
    }
 }
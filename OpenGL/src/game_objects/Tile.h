@@ -6,6 +6,7 @@ class Tile : public SquareObject {
 public:
    Tile(const std::string& name, bool wall, bool unbreakable, float x, float y);
    Tile(const std::string& name, float x, float y);
+   virtual void           render(Renderer& renderer, RenderPass& renderPass) override;
    virtual void           update() override;
    virtual void           explode();
    std::vector<glm::vec2> getBounds();
@@ -14,8 +15,8 @@ public:
 
 
 private:
-   std::shared_ptr<Texture> wallTexture;
-   std::shared_ptr<Texture> wallTextureUnbreakable;
-   std::shared_ptr<Texture> floorTexture;
-   void                     setTexture();
+   glm::vec4 wallTexture;
+   glm::vec4 wallTextureUnbreakable;
+   glm::vec4 floorTexture;
+   void      setTexture();
 };
@@ -9,11 +9,8 @@ Bomber::Bomber(const std::string& name, float x, float y)
 
 bool Bomber::move(int new_x, int new_y) {
 
-   auto nearbyBombsCurrent = World::where<Bomb>([&](const Bomb& bomb) {
-      return (std::abs(getTile().x - bomb.getTile().x) + std::abs(getTile().y - bomb.getTile().y) < 3);
-   });
-   auto nearbyBombsNew     = World::where<Bomb>(
-      [&](const Bomb& bomb) { return (std::abs(new_x - bomb.getTile().x) + std::abs(new_y - bomb.getTile().y) < 3); });
+   auto nearbyBombsCurrent = World::within<Bomb>(getTile(), 3);
+   auto nearbyBombsNew     = World::within<Bomb>({new_x, new_y}, 3);
    if (nearbyBombsNew.empty() || !nearbyBombsCurrent.empty()) {
       Character::move(new_x, new_y);
    }
@@ -55,12 +52,8 @@ void Bomber::tickUpdate() {
    });
 
    // Check for nearby bombs
-   auto nearbyBombs   = World::where<Bomb>([&](const Bomb& bomb) {
-      return (std::abs(getTile().x - bomb.getTile().x) + std::abs(getTile().y - bomb.getTile().y) < 3);
-   });
-   auto nearbyBullets = World::where<Bullet>([&](const Bullet& bullet) {
-      return (std::abs(getTile().x - bullet.getTile().x) + std::abs(getTile().y - bullet.getTile().y) < 3);
-   });
+   auto nearbyBombs   = World::within<Bomb>(getTile(), 3);
+   auto nearbyBullets = World::within<Bullet>(getTile(), 3);
 
    // Move to player
    if (!nearbyBombs.empty()) {
@@ -1,15 +1,22 @@
 #include "BVH.h"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
 #include <cmath>
 
-const float  EPSILON       = 1e-8f;
-const size_t MAX_LEAF_SIZE = 1; // Adjust as needed
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+const float EPSILON = 1e-8f;
 
 float cross(const glm::vec2& v, const glm::vec2& w) {
    return v.x * w.y - v.y * w.x;
 }
 
-BVH BVH::build(std::vector<Segment> segments) {
+BVH BVH::build(std::vector<Segment> segments, const BvhBuildOptions& options) {
    BVH bvh;
    if (segments.empty()) {
       bvh.segments = std::move(segments);
@@ -17,10 +24,105 @@ BVH BVH::build(std::vector<Segment> segments) {
    }
    bvh.segments = std::move(segments);
    // Build the tree recursively starting with all segments
-   bvh.build_recursive(0, bvh.segments.size());
+   BvhBuildOptions clamped = options;
+   clamped.maxDepth        = std::clamp(options.maxDepth, 1u, BVH_MAX_BUILD_DEPTH);
+   clamped.maxLeafSize     = std::max(options.maxLeafSize, 1u);
+   Child root              = bvh.build_recursive(0, bvh.segments.size(), 0, clamped);
+   if (root.type == 1) {
+      // Everything fits in one bucket, which still needs a root node to live in
+      BvhNode node;
+      node.setLeft(1, root.count);
+      node.leftOffset = root.offset;
+      node.leftBBox   = root.bbox;
+      node.setRight(0, 0); // Right child is unused
+      node.rightOffset = 0;
+      node.rightBBox   = glm::vec4(0.0f); // Empty bounding box
+      bvh.nodes.push_back(node);
+      bvh.depth = 1;
+   }
    return bvh;
 }
 
+std::pair<size_t, glm::vec4> BVH::place(const BVH& part, size_t node_offset, size_t segment_offset) {
+   // Copy the part, moving its node and segment offsets along with it
+   auto nodeBase    = static_cast<uint32_t>(node_offset);
+   auto segmentBase = static_cast<uint32_t>(segment_offset);
+   std::copy(part.segments.begin(), part.segments.end(), segments.begin() + segment_offset);
+   for (size_t i = 0; i < part.nodes.size(); i++) {
+      BvhNode node = part.nodes[i];
+      node.leftOffset += node.getLeftType() == 0 ? nodeBase : segmentBase;
+      if (node.rightBBox != glm::vec4(0.0f)) {
+         node.rightOffset += node.getRightType() == 0 ? nodeBase : segmentBase;
+      }
+      nodes[node_offset + i] = node;
+   }
+   size_t root = node_offset + part.nodes.size() - 1;
+   return {root, getBoundingBoxOfNode(nodes[root])};
+}
+
+bool BVH::append_top_level(std::vector<std::pair<size_t, glm::vec4>> roots, uint32_t root_depth) {
+   // Median splits over the roots, or one node holding a single root
+   auto levels = roots.size() > 1 ? static_cast<uint32_t>(std::bit_width(roots.size() - 1)) : 1u;
+   if (root_depth + levels + 1 > BVH_STACK_SIZE) {
+      return false;
+   }
+   depth = root_depth + levels;
+
+   if (roots.size() > 1) {
+      build_top_level(roots, 0, roots.size());
+      return true;
+   }
+
+   // A single root still needs a node at the end, with the right child unused
+   BvhNode node;
+   node.setLeft(0, 0);
+   node.leftOffset = static_cast<uint32_t>(roots[0].first);
+   node.leftBBox   = roots[0].second;
+   node.setRight(0, 0);
+   node.rightOffset = 0;
+   node.rightBBox   = glm::vec4(0.0f);
+   nodes.push_back(node);
+   return true;
+}
+
+size_t BVH::build_top_level(std::vector<std::pair<size_t, glm::vec4>>& roots, size_t root_start, size_t root_end) {
+   if (root_end - root_start == 1) {
+      return roots[root_start].first;
+   }
+
+   // Split the roots at the median along the axis with the largest spread
+   glm::vec2 min = glm::vec2(std::numeric_limits<float>::infinity());
+   glm::vec2 max = -min;
+   for (size_t i = root_start; i < root_end; ++i) {
+      glm::vec2 center = (glm::vec2(roots[i].second.x, roots[i].second.y) +
+                          glm::vec2(roots[i].second.z, roots[i].second.w)) * 0.5f;
+      min              = glm::min(min, center);
+      max              = glm::max(max, center);
+   }
+   int  axis     = (max.y - min.y) > (max.x - min.x) ? 1 : 0;
+   auto centroid = [axis](const std::pair<size_t, glm::vec4>& root) {
+      return root.second[axis] + root.second[axis + 2];
+   };
+   std::sort(roots.begin() + root_start, roots.begin() + root_end,
+             [&](const auto& a, const auto& b) { return centroid(a) < centroid(b); });
+   size_t mid = (root_start + root_end) / 2;
+
+   size_t leftChildIndex  = build_top_level(roots, root_start, mid);
+   size_t rightChildIndex = build_top_level(roots, mid, root_end);
+
+   BvhNode node;
+   node.setLeft(0, 0); // 0 indicates a node
+   node.leftOffset = static_cast<uint32_t>(leftChildIndex);
+   node.leftBBox   = getBoundingBoxOfNode(nodes[leftChildIndex]);
+   node.setRight(0, 0); // 0 indicates a node
+   node.rightOffset = static_cast<uint32_t>(rightChildIndex);
+   node.rightBBox   = getBoundingBoxOfNode(nodes[rightChildIndex]);
+
+   size_t node_idx = nodes.size();
+   nodes.push_back(node);
+   return node_idx;
+}
+
 glm::vec4 BVH::getBoundingBoxOfNode(const BvhNode& node) const {
    float min_x = node.leftBBox.x;
    float min_y = node.leftBBox.y;
@@ -38,60 +140,39 @@ glm::vec4 BVH::getBoundingBoxOfNode(const BvhNode& node) const {
    return glm::vec4(min_x, min_y, max_x, max_y);
 }
 
-size_t BVH::build_recursive(size_t segment_start, size_t segment_end) {
+BVH::Child BVH::build_recursive(size_t segment_start, size_t segment_end, uint32_t depth,
+                                const BvhBuildOptions& options) {
    // Calculate AABB for current node
-   AABB aabb = compute_aabb(segment_start, segment_end);
-
-   // Create leaf node if we have few enough segments
-   if (segment_end - segment_start <= MAX_LEAF_SIZE) {
-      BvhNode node;
-
-      // Leaf node - set left child as line bucket
-      uint32_t leftType  = 1; // 1 indicates a line bucket
-      uint32_t leftCount = static_cast<uint32_t>(segment_end - segment_start);
-      node.setLeft(leftType, leftCount);
-      node.leftOffset = static_cast<uint32_t>(segment_start); // Index into segments array
-
-      // Set leftBBox
-      node.leftBBox = glm::vec4(aabb.min, aabb.max);
-
-      // No right child for leaf node
-      node.setRight(0, 0); // Right child is unused
-      node.rightOffset = 0;
-      node.rightBBox   = glm::vec4(0.0f); // Empty bounding box
-
-      size_t node_idx = nodes.size();
-      nodes.push_back(node);
-      return node_idx;
+   AABB      aabb  = compute_aabb(segment_start, segment_end);
+   glm::vec4 bbox  = glm::vec4(aabb.min, aabb.max);
+   size_t    count = segment_end - segment_start;
+
+   // Partition segments, or keep them together as a bucket
+   size_t mid = count > 1 ? partition_segments(segment_start, segment_end, depth, options) : segment_start;
+   if (mid == segment_start) {
+      return Child{1, static_cast<uint32_t>(count), static_cast<uint32_t>(segment_start), bbox}; // 1 is a line bucket
    }
 
-   // Partition segments
-   size_t mid = partition_segments(segment_start, segment_end);
-
    // Recursively build left and right children
-   size_t leftChildIndex  = build_recursive(segment_start, mid);
-   size_t rightChildIndex = build_recursive(mid, segment_end);
-
-   // Compute bounding boxes of children
-   glm::vec4 leftChildBBox  = getBoundingBoxOfNode(nodes[leftChildIndex]);
-   glm::vec4 rightChildBBox = getBoundingBoxOfNode(nodes[rightChildIndex]);
+   Child left  = build_recursive(segment_start, mid, depth + 1, options);
+   Child right = build_recursive(mid, segment_end, depth + 1, options);
 
    // Create internal node
    BvhNode node;
 
    // Left child
-   node.setLeft(0, 0); // 0 indicates a node
-   node.leftOffset = static_cast<uint32_t>(leftChildIndex);
-   node.leftBBox   = leftChildBBox;
+   node.setLeft(left.type, left.count);
+   node.leftOffset = left.offset;
+   node.leftBBox   = left.bbox;
 
    // Right child
-   node.setRight(0, 0); // 0 indicates a node
-   node.rightOffset = static_cast<uint32_t>(rightChildIndex);
-   node.rightBBox   = rightChildBBox;
+   node.setRight(right.type, right.count);
+   node.rightOffset = right.offset;
+   node.rightBBox   = right.bbox;
 
-   size_t node_idx = nodes.size();
    nodes.push_back(node);
-   return node_idx;
+   this->depth = std::max(this->depth, depth + 1);
+   return Child{0, 0, static_cast<uint32_t>(nodes.size() - 1), bbox}; // 0 is a node
 }
 
 AABB BVH::compute_aabb(size_t segment_start, size_t segment_end) const {
@@ -114,123 +195,192 @@ AABB BVH::compute_aabb(size_t segment_start, size_t segment_end) const {
    };
 }
 
-size_t BVH::partition_segments(size_t segment_start, size_t segment_end) {
-   AABB  aabb   = compute_aabb(segment_start, segment_end);
-   float width  = aabb.max.x - aabb.min.x;
-   float height = aabb.max.y - aabb.min.y;
-
-   // Choose axis with the largest spread
-   bool axis_vertical = height > width;
+size_t BVH::partition_segments(size_t segment_start, size_t segment_end, uint32_t depth,
+                               const BvhBuildOptions& options) {
+   constexpr float infinity = std::numeric_limits<float>::infinity();
+   size_t          count    = segment_end - segment_start;
+   auto            begin    = segments.begin() + segment_start;
+   auto            end      = segments.begin() + segment_end;
+
+   auto centroid      = [](const Segment& segment) { return (segment.start + segment.end) * 0.5f; };
+   auto grow          = [](AABB& box, const AABB& other) {
+      box.min = glm::min(box.min, other.min);
+      box.max = glm::max(box.max, other.max);
+   };
+   auto segmentBounds = [](const Segment& segment) {
+      return AABB{glm::min(segment.start, segment.end), glm::max(segment.start, segment.end)};
+   };
+   auto halfPerimeter = [](const AABB& box) { return (box.max.x - box.min.x) + (box.max.y - box.min.y); };
 
-   // Lambda to compute the centroid of a segment
-   auto centroid = [axis_vertical](const Segment& segment) {
-      if (axis_vertical) {
-         return (segment.start.y + segment.end.y) / 2.0f;
-      } else {
-         return (segment.start.x + segment.end.x) / 2.0f;
-      }
+   // Choose the axis with the largest spread of centroids
+   AABB centroids{glm::vec2(infinity), glm::vec2(-infinity)};
+   for (auto it = begin; it != end; ++it) {
+      grow(centroids, AABB{centroid(*it), centroid(*it)});
+   }
+   int   axis   = (centroids.max.y - centroids.min.y) > (centroids.max.x - centroids.min.x) ? 1 : 0;
+   float extent = centroids.max[axis] - centroids.min[axis];
+
+   auto medianSplit = [&]() {
+      size_t mid = (segment_start + segment_end) / 2;
+      std::nth_element(begin, segments.begin() + mid, end, [&](const Segment& a, const Segment& b) {
+         return centroid(a)[axis] < centroid(b)[axis];
+      });
+      return mid;
    };
 
-   // Get mutable iterator range for the segments
-   auto segments_begin  = segments.begin() + segment_start;
-   auto segments_end_it = segments.begin() + segment_end;
+   // A node here would be one level too many for the traversal stack, so the range becomes a bucket however big it is.
+   // Median splits need the fewest levels, they take over once those are all that's left.
+   if (depth >= options.maxDepth) {
+      return segment_start;
+   }
+   auto medianLevels = static_cast<uint32_t>(std::bit_width((count - 1) / options.maxLeafSize));
+   if (extent <= 0.0f || options.maxDepth - depth <= medianLevels) {
+      return count <= options.maxLeafSize ? segment_start : medianSplit();
+   }
+
+   // Sort the segments into bins along the axis
+   struct Bin {
+      AABB   bounds{glm::vec2(infinity), glm::vec2(-infinity)};
+      size_t count = 0;
+   };
+   size_t binCount = std::max<size_t>(options.binCount, 2);
+   auto   binOf    = [&](const Segment& segment) {
+      auto bin = static_cast<size_t>((centroid(segment)[axis] - centroids.min[axis]) / extent * binCount);
+      return std::min(bin, binCount - 1);
+   };
+   std::vector<Bin> bins(binCount);
+   for (auto it = begin; it != end; ++it) {
+      Bin& bin = bins[binOf(*it)];
+      grow(bin.bounds, segmentBounds(*it));
+      bin.count++;
+   }
 
-   // Sort the segments in place based on their centroids
-   std::sort(segments_begin, segments_end_it,
-             [centroid](const Segment& a, const Segment& b) { return centroid(a) < centroid(b); });
+   // Cost of everything right of each bin boundary, then sweep from the left to find the cheapest boundary
+   std::vector<float> rightCosts(binCount, infinity);
+   AABB               right{glm::vec2(infinity), glm::vec2(-infinity)};
+   size_t             rightCount = 0;
+   for (size_t i = binCount - 1; i > 0; --i) {
+      grow(right, bins[i].bounds);
+      rightCount += bins[i].count;
+      rightCosts[i] = rightCount > 0 ? halfPerimeter(right) * rightCount : infinity;
+   }
 
-   // Return the midpoint index for splitting
-   return (segment_start + segment_end) / 2;
-}
+   float  bestCost = infinity;
+   size_t bestBin  = 0;
+   AABB   left{glm::vec2(infinity), glm::vec2(-infinity)};
+   size_t leftCount = 0;
+   for (size_t i = 0; i + 1 < binCount; ++i) {
+      grow(left, bins[i].bounds);
+      leftCount += bins[i].count;
+      if (leftCount == 0 || leftCount == count) {
+         continue;
+      }
+      float cost = halfPerimeter(left) * leftCount + rightCosts[i + 1];
+      if (cost < bestCost) {
+         bestCost = cost;
+         bestBin  = i;
+      }
+   }
 
-std::optional<std::pair<glm::vec2, const Segment*>> BVH::ray_intersect(const Ray& ray) const {
-   if (nodes.empty()) {
-      return std::nullopt;
+   // Visiting a node costs about as much as testing one segment
+   AABB  bounds    = compute_aabb(segment_start, segment_end);
+   float leafCost  = halfPerimeter(bounds) * count;
+   float splitCost = halfPerimeter(bounds) + bestCost;
+   if (count <= options.maxLeafSize && leafCost <= splitCost) {
+      return segment_start;
    }
-   auto result = ray_intersect_node(ray, nodes.size() - 1, std::nullopt); // Start from root node
-   if (result.has_value()) {
-      auto [p, t, segment_ptr] = result.value();
-      return std::make_optional(std::make_pair(p, segment_ptr));
-   } else {
-      return std::nullopt;
+   if (bestCost == infinity) {
+      return medianSplit();
    }
+
+   auto mid = std::partition(begin, end, [&](const Segment& segment) { return binOf(segment) <= bestBin; });
+   if (mid == begin || mid == end) {
+      return medianSplit();
+   }
+   return static_cast<size_t>(mid - segments.begin());
 }
 
+template <typename HitTest>
 std::optional<std::tuple<glm::vec2, float, const Segment*>>
-BVH::ray_intersect_node(const Ray& ray, size_t node_idx,
-                        std::optional<std::tuple<glm::vec2, float, const Segment*>> closest) const {
-   const BvhNode& node = nodes[node_idx];
-
-   // Check intersection with left child bounding box
-   AABB leftAABB{glm::vec2(node.leftBBox.x, node.leftBBox.y), glm::vec2(node.leftBBox.z, node.leftBBox.w)};
-   auto left_aabb_hit = intersect_ray_aabb(ray, leftAABB);
-
-   if (left_aabb_hit.has_value()) {
-      uint32_t leftType = node.getLeftType();
-      if (leftType == 0) {
-         // Left child is a node
-         size_t childIdx = node.leftOffset;
-         closest         = ray_intersect_node(ray, childIdx, closest);
-      } else {
-         // Left child is a line bucket (leaf node)
-         uint32_t count  = node.getLeftCount();
-         uint32_t offset = node.leftOffset;
-         for (uint32_t i = 0; i < count; ++i) {
-            const Segment& segment      = segments[offset + i];
-            auto           intersection = intersect_ray_segment(ray, segment);
-            if (intersection.has_value()) {
-               glm::vec2 p = intersection->first;
-               float     t = intersection->second;
-               if (t >= 0.0f) {
-                  if (!closest.has_value() || t < std::get<1>(closest.value())) {
-                     closest = std::make_optional(std::make_tuple(p, t, &segment));
-                  }
-               }
+BVH::closest_hit(const glm::vec2& origin, const glm::vec2& direction, float maxT, HitTest hit) const {
+   std::optional<std::tuple<glm::vec2, float, const Segment*>> closest;
+   if (nodes.empty()) {
+      return closest;
+   }
+
+   struct StackEntry {
+      uint32_t type; // 0 is a node, 1 is a line bucket
+      uint32_t count;
+      uint32_t offset;
+      float    t; // where the ray enters the child's bounding box
+   };
+   std::array<StackEntry, BVH_STACK_SIZE> stack;
+   size_t                                 stackSize = 0;
+
+   // Start from the root node
+   stack[stackSize++] = StackEntry{0, 0, static_cast<uint32_t>(nodes.size() - 1), 0.0f};
+
+   float closestT = std::numeric_limits<float>::infinity();
+   while (stackSize > 0) {
+      StackEntry entry = stack[--stackSize];
+      if (entry.t >= closestT) {
+         continue; // Everything in here is further away than what we already hit
+      }
+
+      if (entry.type == 1) {
+         for (uint32_t i = 0; i < entry.count; ++i) {
+            const Segment& segment      = segments[entry.offset + i];
+            auto           intersection = hit(segment);
+            if (intersection.has_value() && intersection->second < closestT) {
+               closestT = intersection->second;
+               closest  = std::make_tuple(intersection->first, closestT, &segment);
             }
          }
+         continue;
       }
-   }
 
-   // Check intersection with right child bounding box
-   if (node.rightBBox != glm::vec4(0.0f)) { // Check if right child exists
-      AABB rightAABB{glm::vec2(node.rightBBox.x, node.rightBBox.y), glm::vec2(node.rightBBox.z, node.rightBBox.w)};
-      auto right_aabb_hit = intersect_ray_aabb(ray, rightAABB);
+      const BvhNode&            node  = nodes[entry.offset];
+      std::optional<StackEntry> left  = std::nullopt;
+      std::optional<StackEntry> right = std::nullopt;
+      if (auto t = entry_t(origin, direction, node.leftBBox, maxT); t && *t < closestT) {
+         left = StackEntry{node.getLeftType(), node.getLeftCount(), node.leftOffset, *t};
+      }
+      if (node.rightBBox != glm::vec4(0.0f)) { // Check if right child exists
+         if (auto t = entry_t(origin, direction, node.rightBBox, maxT); t && *t < closestT) {
+            right = StackEntry{node.getRightType(), node.getRightCount(), node.rightOffset, *t};
+         }
+      }
 
-      if (right_aabb_hit.has_value()) {
-         uint32_t rightType = node.getRightType();
-         if (rightType == 0) {
-            // Right child is a node
-            size_t childIdx = node.rightOffset;
-            closest         = ray_intersect_node(ray, childIdx, closest);
-         } else {
-            // Right child is a line bucket (leaf node)
-            uint32_t count  = node.getRightCount();
-            uint32_t offset = node.rightOffset;
-            for (uint32_t i = 0; i < count; ++i) {
-               const Segment& segment      = segments[offset + i];
-               auto           intersection = intersect_ray_segment(ray, segment);
-               if (intersection.has_value()) {
-                  glm::vec2 p = intersection->first;
-                  float     t = intersection->second;
-                  if (t >= 0.0f) {
-                     if (!closest.has_value() || t < std::get<1>(closest.value())) {
-                        closest = std::make_optional(std::make_tuple(p, t, &segment));
-                     }
-                  }
-               }
-            }
+      // Push the further child first so the nearer one is visited first
+      if (left && right && left->t < right->t) {
+         std::swap(left, right);
+      }
+      for (auto& child : {left, right}) {
+         if (child) {
+            // build() and append_top_level() keep the depth within the stack
+            assert(stackSize < BVH_STACK_SIZE && "BVH is deeper than the traversal stack");
+            stack[stackSize++] = *child;
          }
       }
    }
-
    return closest;
 }
 
-std::optional<std::pair<glm::vec2, const Segment*>> BVH::segment_intersect(const Segment& segment) const {
-   if (nodes.empty()) {
+std::optional<std::pair<glm::vec2, const Segment*>> BVH::ray_intersect(const Ray& ray) const {
+   auto result = closest_hit(ray.origin, ray.direction, std::numeric_limits<float>::infinity(),
+                             [&](const Segment& segment) { return intersect_ray_segment(ray, segment); });
+   if (result.has_value()) {
+      auto [p, t, segment_ptr] = result.value();
+      return std::make_optional(std::make_pair(p, segment_ptr));
+   } else {
       return std::nullopt;
    }
-   auto result = segment_intersect_node(segment, nodes.size() - 1, std::nullopt); // Start from root node
+}
+
+std::optional<std::pair<glm::vec2, const Segment*>> BVH::segment_intersect(const Segment& segment) const {
+   auto result = closest_hit(segment.start, segment.end - segment.start, 1.0f, [&](const Segment& other_segment) {
+      return intersect_segment_segment(segment, other_segment);
+   });
    if (result.has_value()) {
       auto [p, t, segment_ptr] = result.value();
       return std::make_optional(std::make_pair(p, segment_ptr));
@@ -239,70 +389,219 @@ std::optional<std::pair<glm::vec2, const Segment*>> BVH::segment_intersect(const
    }
 }
 
-std::optional<std::tuple<glm::vec2, float, const Segment*>>
-BVH::segment_intersect_node(const Segment& segment, size_t node_idx,
-                            std::optional<std::tuple<glm::vec2, float, const Segment*>> closest) const {
-   const BvhNode& node = nodes[node_idx];
-
-   // Check intersection with left child bounding box
-   AABB leftAABB{glm::vec2(node.leftBBox.x, node.leftBBox.y), glm::vec2(node.leftBBox.z, node.leftBBox.w)};
-   if (intersect_segment_aabb(segment, leftAABB)) {
-      uint32_t leftType = node.getLeftType();
-      if (leftType == 0) {
-         // Left child is a node
-         size_t childIdx = node.leftOffset;
-         closest         = segment_intersect_node(segment, childIdx, closest);
-      } else {
-         // Left child is a line bucket (leaf node)
-         uint32_t count  = node.getLeftCount();
-         uint32_t offset = node.leftOffset;
-         for (uint32_t i = 0; i < count; ++i) {
-            const Segment& other_segment = segments[offset + i];
-            auto           intersection  = intersect_segment_segment(segment, other_segment);
-            if (intersection.has_value()) {
-               glm::vec2 p = intersection->first;
-               float     t = intersection->second;
-               if (t >= 0.0f && t <= 1.0f) {
-                  if (!closest.has_value() || t < std::get<1>(closest.value())) {
-                     closest = std::make_optional(std::make_tuple(p, t, &other_segment));
-                  }
+namespace {
+
+void setLane(BVH::Packet& packet, int lane, const glm::vec2& origin, const glm::vec2& direction, float maxT) {
+   // Nudge zero direction components so the slab test never multiplies zero by infinity
+   auto inverse = [](float d) { return 1.0f / (std::abs(d) < EPSILON ? std::copysign(EPSILON, d) : d); };
+
+   packet.originX[lane]    = origin.x;
+   packet.originY[lane]    = origin.y;
+   packet.directionX[lane] = direction.x;
+   packet.directionY[lane] = direction.y;
+   packet.inverseX[lane]   = inverse(direction.x);
+   packet.inverseY[lane]   = inverse(direction.y);
+   packet.maxT[lane]       = maxT;
+}
+
+// Entry t of the four lanes into a box (min.x, min.y, max.x, max.y). Returns the mask of lanes that enter it before
+// their `limit`.
+int packetEntry(const BVH::Packet& packet, const glm::vec4& box, const float limit[4], float entry[4]) {
+#ifdef BVH_USE_SSE
+   __m128 originX = _mm_load_ps(packet.originX);
+   __m128 originY = _mm_load_ps(packet.originY);
+   __m128 t0x     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.x), originX), _mm_load_ps(packet.inverseX));
+   __m128 t1x     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.z), originX), _mm_load_ps(packet.inverseX));
+   __m128 t0y     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.y), originY), _mm_load_ps(packet.inverseY));
+   __m128 t1y     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.w), originY), _mm_load_ps(packet.inverseY));
+   __m128 tmin    = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_setzero_ps());
+   __m128 tmax    = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_load_ps(packet.maxT));
+   __m128 hit     = _mm_and_ps(_mm_cmple_ps(tmin, tmax), _mm_cmplt_ps(tmin, _mm_loadu_ps(limit)));
+   _mm_storeu_ps(entry, tmin);
+   return _mm_movemask_ps(hit);
+#else
+   int lanes = 0;
+   for (int lane = 0; lane < 4; ++lane) {
+      float t0x  = (box.x - packet.originX[lane]) * packet.inverseX[lane];
+      float t1x  = (box.z - packet.originX[lane]) * packet.inverseX[lane];
+      float t0y  = (box.y - packet.originY[lane]) * packet.inverseY[lane];
+      float t1y  = (box.w - packet.originY[lane]) * packet.inverseY[lane];
+      float tmin = std::max({std::min(t0x, t1x), std::min(t0y, t1y), 0.0f});
+      float tmax = std::min({std::max(t0x, t1x), std::max(t0y, t1y), packet.maxT[lane]});
+      entry[lane] = tmin;
+      if (tmin <= tmax && tmin < limit[lane]) {
+         lanes |= 1 << lane;
+      }
+   }
+   return lanes;
+#endif
+}
+
+// Same as intersect_segment_segment for the four lanes against one segment. Returns the mask of lanes that hit it
+// before their `limit`, with the hit parameters in `t`.
+int packetSegment(const BVH::Packet& packet, const Segment& segment, const float limit[4], float t[4]) {
+   float sx = segment.end.x - segment.start.x;
+   float sy = segment.end.y - segment.start.y;
+#ifdef BVH_USE_SSE
+   __m128 directionX = _mm_load_ps(packet.directionX);
+   __m128 directionY = _mm_load_ps(packet.directionY);
+   __m128 qpx        = _mm_sub_ps(_mm_set1_ps(segment.start.x), _mm_load_ps(packet.originX));
+   __m128 qpy        = _mm_sub_ps(_mm_set1_ps(segment.start.y), _mm_load_ps(packet.originY));
+   __m128 rCrossS    = _mm_sub_ps(_mm_mul_ps(directionX, _mm_set1_ps(sy)), _mm_mul_ps(directionY, _mm_set1_ps(sx)));
+   __m128 tt = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qpx, _mm_set1_ps(sy)), _mm_mul_ps(qpy, _mm_set1_ps(sx))), rCrossS);
+   __m128 u  = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qpx, directionY), _mm_mul_ps(qpy, directionX)), rCrossS);
+
+   // Parallel lines divide by (nearly) zero, those lanes are masked out by the first test
+   __m128 hit = _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), rCrossS), _mm_set1_ps(EPSILON));
+   hit        = _mm_and_ps(hit, _mm_cmpge_ps(tt, _mm_setzero_ps()));
+   hit        = _mm_and_ps(hit, _mm_cmple_ps(tt, _mm_load_ps(packet.maxT)));
+   hit        = _mm_and_ps(hit, _mm_cmpge_ps(u, _mm_setzero_ps()));
+   hit        = _mm_and_ps(hit, _mm_cmple_ps(u, _mm_set1_ps(1.0f)));
+   hit        = _mm_and_ps(hit, _mm_cmplt_ps(tt, _mm_loadu_ps(limit)));
+   _mm_storeu_ps(t, tt);
+   return _mm_movemask_ps(hit);
+#else
+   int lanes = 0;
+   for (int lane = 0; lane < 4; ++lane) {
+      float rCrossS = packet.directionX[lane] * sy - packet.directionY[lane] * sx;
+      if (std::abs(rCrossS) < EPSILON) {
+         continue; // Lines are parallel
+      }
+      float qpx = segment.start.x - packet.originX[lane];
+      float qpy = segment.start.y - packet.originY[lane];
+      float tt  = (qpx * sy - qpy * sx) / rCrossS;
+      float u   = (qpx * packet.directionY[lane] - qpy * packet.directionX[lane]) / rCrossS;
+      t[lane]   = tt;
+      if (tt >= 0.0f && tt <= packet.maxT[lane] && u >= 0.0f && u <= 1.0f && tt < limit[lane]) {
+         lanes |= 1 << lane;
+      }
+   }
+   return lanes;
+#endif
+}
+
+} // namespace
+
+void BVH::packet_closest_hits(const Packet& packet, int activeLanes, Hit results[4]) const {
+   // Inactive lanes never get closer than -infinity, so every test rejects them
+   float          closest[4];
+   const Segment* closestSegment[4] = {};
+   for (int lane = 0; lane < 4; ++lane) {
+      closest[lane] = (activeLanes >> lane) & 1 ? std::numeric_limits<float>::infinity()
+                                                : -std::numeric_limits<float>::infinity();
+   }
+
+   struct StackEntry {
+      uint32_t type; // 0 is a node, 1 is a line bucket
+      uint32_t count;
+      uint32_t offset;
+      int      lanes;    // lanes that entered the child's bounding box
+      float    entry[4]; // where they entered it
+   };
+   std::array<StackEntry, BVH_STACK_SIZE> stack;
+   size_t                                 stackSize = 0;
+
+   // Start from the root node
+   if (!nodes.empty()) {
+      stack[stackSize++] = StackEntry{0, 0, static_cast<uint32_t>(nodes.size() - 1), activeLanes, {}};
+   }
+
+   while (stackSize > 0) {
+      StackEntry entry = stack[--stackSize];
+      for (int lane = 0; lane < 4; ++lane) {
+         if (entry.entry[lane] >= closest[lane]) {
+            entry.lanes &= ~(1 << lane); // This lane already hit something closer
+         }
+      }
+      if (entry.lanes == 0) {
+         continue;
+      }
+
+      if (entry.type == 1) {
+         for (uint32_t i = 0; i < entry.count; ++i) {
+            const Segment& segment = segments[entry.offset + i];
+            float          t[4];
+            int            hits = packetSegment(packet, segment, closest, t) & entry.lanes;
+            for (int lane = 0; lane < 4; ++lane) {
+               if ((hits >> lane) & 1) {
+                  closest[lane]        = t[lane];
+                  closestSegment[lane] = &segment;
                }
             }
          }
+         continue;
       }
-   }
 
-   // Check intersection with right child bounding box
-   if (node.rightBBox != glm::vec4(0.0f)) { // Check if right child exists
-      AABB rightAABB{glm::vec2(node.rightBBox.x, node.rightBBox.y), glm::vec2(node.rightBBox.z, node.rightBBox.w)};
-      if (intersect_segment_aabb(segment, rightAABB)) {
-         uint32_t rightType = node.getRightType();
-         if (rightType == 0) {
-            // Right child is a node
-            size_t childIdx = node.rightOffset;
-            closest         = segment_intersect_node(segment, childIdx, closest);
-         } else {
-            // Right child is a line bucket (leaf node)
-            uint32_t count  = node.getRightCount();
-            uint32_t offset = node.rightOffset;
-            for (uint32_t i = 0; i < count; ++i) {
-               const Segment& other_segment = segments[offset + i];
-               auto           intersection  = intersect_segment_segment(segment, other_segment);
-               if (intersection.has_value()) {
-                  glm::vec2 p = intersection->first;
-                  float     t = intersection->second;
-                  if (t >= 0.0f && t <= 1.0f) {
-                     if (!closest.has_value() || t < std::get<1>(closest.value())) {
-                        closest = std::make_optional(std::make_tuple(p, t, &other_segment));
-                     }
-                  }
-               }
+      const BvhNode& node = nodes[entry.offset];
+      StackEntry     left{node.getLeftType(), node.getLeftCount(), node.leftOffset, 0, {}};
+      StackEntry     right{node.getRightType(), node.getRightCount(), node.rightOffset, 0, {}};
+      left.lanes = packetEntry(packet, node.leftBBox, closest, left.entry) & entry.lanes;
+      if (node.rightBBox != glm::vec4(0.0f)) { // Check if right child exists
+         right.lanes = packetEntry(packet, node.rightBBox, closest, right.entry) & entry.lanes;
+      }
+
+      // Push the further child first so the nearer one is visited first
+      auto nearest = [](const StackEntry& child) {
+         float t = std::numeric_limits<float>::infinity();
+         for (int lane = 0; lane < 4; ++lane) {
+            if ((child.lanes >> lane) & 1) {
+               t = std::min(t, child.entry[lane]);
             }
          }
+         return t;
+      };
+      if (nearest(left) < nearest(right)) {
+         std::swap(left, right);
+      }
+      for (const auto& child : {left, right}) {
+         if (child.lanes != 0) {
+            // build() and append_top_level() keep the depth within the stack
+            assert(stackSize < BVH_STACK_SIZE && "BVH is deeper than the traversal stack");
+            stack[stackSize++] = child;
+         }
       }
    }
 
-   return closest;
+   for (int lane = 0; lane < 4; ++lane) {
+      if (!((activeLanes >> lane) & 1)) {
+         continue;
+      }
+      if (closestSegment[lane]) {
+         glm::vec2 origin(packet.originX[lane], packet.originY[lane]);
+         glm::vec2 direction(packet.directionX[lane], packet.directionY[lane]);
+         results[lane] = std::make_pair(origin + closest[lane] * direction, closestSegment[lane]);
+      } else {
+         results[lane] = std::nullopt;
+      }
+   }
+}
+
+void BVH::ray_intersect_batch(std::span<const Ray> rays, std::span<Hit> results) const {
+   assert(results.size() >= rays.size());
+   for (size_t first = 0; first < rays.size(); first += 4) {
+      Packet packet{};
+      int    activeLanes = 0;
+      for (int lane = 0; lane < 4 && first + lane < rays.size(); ++lane) {
+         const Ray& ray = rays[first + lane];
+         setLane(packet, lane, ray.origin, ray.direction, std::numeric_limits<float>::infinity());
+         activeLanes |= 1 << lane;
+      }
+      packet_closest_hits(packet, activeLanes, &results[first]);
+   }
+}
+
+void BVH::segment_intersect_batch(std::span<const Segment> queries, std::span<Hit> results) const {
+   assert(results.size() >= queries.size());
+   for (size_t first = 0; first < queries.size(); first += 4) {
+      Packet packet{};
+      int    activeLanes = 0;
+      for (int lane = 0; lane < 4 && first + lane < queries.size(); ++lane) {
+         const Segment& query = queries[first + lane];
+         setLane(packet, lane, query.start, query.end - query.start, 1.0f);
+         activeLanes |= 1 << lane;
+      }
+      packet_closest_hits(packet, activeLanes, &results[first]);
+   }
 }
 
 // Utility functions for intersection tests
@@ -419,3 +718,29 @@ bool intersect_segment_aabb(const Segment& segment, const AABB& aabb) {
    }
    return true;
 }
+
+std::optional<float> entry_t(const glm::vec2& origin, const glm::vec2& direction, const glm::vec4& box, float maxT) {
+   float tmin = 0.0f;
+   float tmax = maxT;
+   for (int axis = 0; axis < 2; ++axis) {
+      float lower = box[axis];
+      float upper = box[axis + 2];
+      if (std::abs(direction[axis]) < EPSILON) {
+         // Parallel to this slab, so it has to start inside it
+         if (origin[axis] < lower || origin[axis] > upper)
+            return std::nullopt;
+         continue;
+      }
+
+      float t0 = (lower - origin[axis]) / direction[axis];
+      float t1 = (upper - origin[axis]) / direction[axis];
+      if (t0 > t1)
+         std::swap(t0, t1);
+
+      tmin = std::max(tmin, t0);
+      tmax = std::min(tmax, t1);
+      if (tmin > tmax)
+         return std::nullopt;
+   }
+   return tmin;
+}
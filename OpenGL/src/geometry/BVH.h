@@ -5,6 +5,9 @@
 #include <limits>
 #include <vector>
 #include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
 #include <cstdint>
 
 struct Ray {
@@ -43,33 +46,92 @@ struct BvhNode {
    void     setRight(uint32_t type, uint32_t count) { rightTypeCount = (type << 31) | (count & 0x7FFFFFFF); }
 };
 
+// Traversals keep the far child of every node on the way down on a fixed size stack, so a tree with n levels of nodes
+// needs n + 1 entries. build() makes at most BVH_MAX_BUILD_DEPTH levels, which leaves BVH_MAX_TOP_LEVEL_DEPTH levels
+// for append_top_level() (and res/shaders/bvh.wgsl uses the same stack size).
+constexpr size_t   BVH_STACK_SIZE          = 64;
+constexpr uint32_t BVH_MAX_TOP_LEVEL_DEPTH = 15;
+constexpr uint32_t BVH_MAX_BUILD_DEPTH     = BVH_STACK_SIZE - 1 - BVH_MAX_TOP_LEVEL_DEPTH;
+
+struct BvhBuildOptions {
+   uint32_t binCount    = 16; // Candidate split positions per node for the surface area heuristic
+   uint32_t maxLeafSize = 4;  // Ranges up to this size may become a bucket when that's cheaper than splitting
+   // Levels of nodes at most, clamped to BVH_MAX_BUILD_DEPTH. Once a median split tree only just fits in the levels
+   // left, median splits are used instead of the surface area heuristic, and ranges at the limit become buckets.
+   uint32_t maxDepth = BVH_MAX_BUILD_DEPTH;
+};
+static_assert(BvhBuildOptions{}.maxDepth + BVH_MAX_TOP_LEVEL_DEPTH + 1 <= BVH_STACK_SIZE,
+              "Default BVHs plus a top level have to fit in the traversal stack");
+
 struct BVH {
    std::vector<BvhNode> nodes;
    std::vector<Segment> segments;
+   uint32_t             depth = 0; // Levels of nodes on the longest path down from the root
+
+   // A child slot of a BvhNode while building: a node (type 0) or a bucket of segments (type 1)
+   struct Child {
+      uint32_t  type;
+      uint32_t  count;
+      uint32_t  offset;
+      glm::vec4 bbox;
+   };
+
+   static BVH build(std::vector<Segment> segments, const BvhBuildOptions& options = {});
 
-   static BVH build(std::vector<Segment> segments);
+   /// Copy an already built BVH into nodes / segments starting at the given offsets, which must have room for it.
+   /// Returns the index and bounding box of its root. Used to keep many small BVHs in one set of arrays.
+   std::pair<size_t, glm::vec4> place(const BVH& part, size_t node_offset, size_t segment_offset);
 
-   size_t build_recursive(size_t segment_start, size_t segment_end);
+   /// Append a small tree over the roots of placed parts (all of them, every time), so its root is the last node.
+   /// `root_depth` is the depth of the deepest part. Returns false, without adding anything, if the whole tree would be
+   /// too deep for the traversal stack.
+   bool append_top_level(std::vector<std::pair<size_t, glm::vec4>> roots, uint32_t root_depth);
+
+   Child build_recursive(size_t segment_start, size_t segment_end, uint32_t depth, const BvhBuildOptions& options);
+
+   size_t build_top_level(std::vector<std::pair<size_t, glm::vec4>>& roots, size_t root_start, size_t root_end);
 
    AABB compute_aabb(size_t segment_start, size_t segment_end) const;
 
-   size_t partition_segments(size_t segment_start, size_t segment_end);
+   /// Split the range with a binned surface area heuristic (a perimeter heuristic in 2D). Returns the first index of
+   /// the right half, or segment_start if the range should become a bucket.
+   size_t partition_segments(size_t segment_start, size_t segment_end, uint32_t depth, const BvhBuildOptions& options);
 
    glm::vec4 getBoundingBoxOfNode(const BvhNode& node) const;
 
    /// Find the closest intersection point between a ray and any segment in the BVH.
    std::optional<std::pair<glm::vec2, const Segment*>> ray_intersect(const Ray& ray) const;
 
-   std::optional<std::tuple<glm::vec2, float, const Segment*>>
-   ray_intersect_node(const Ray& ray, size_t node_idx,
-                      std::optional<std::tuple<glm::vec2, float, const Segment*>> closest) const;
-
    /// Find the closest intersection point between a segment and any segment in the BVH.
    std::optional<std::pair<glm::vec2, const Segment*>> segment_intersect(const Segment& segment) const;
 
-   std::optional<std::tuple<glm::vec2, float, const Segment*>>
-   segment_intersect_node(const Segment& segment, size_t node_idx,
-                          std::optional<std::tuple<glm::vec2, float, const Segment*>> closest) const;
+   using Hit = std::optional<std::pair<glm::vec2, const Segment*>>;
+
+   /// Closest hits of many rays / segments at once, written to results[i] (which must have room for every query).
+   /// Queries are walked through the tree in packets of four sharing one traversal, with the box and segment tests
+   /// done four at a time (SSE when available, scalar otherwise).
+   void ray_intersect_batch(std::span<const Ray> rays, std::span<Hit> results) const;
+   void segment_intersect_batch(std::span<const Segment> queries, std::span<Hit> results) const;
+
+   /// Walk the tree front to back along origin + t * direction for t in [0, maxT], calling `hit` on the segments of
+   /// every bucket that could still hold a closer hit. `hit` returns the (point, t) of an intersection, if any.
+   template <typename HitTest>
+   std::optional<std::tuple<glm::vec2, float, const Segment*>> closest_hit(const glm::vec2& origin,
+                                                                           const glm::vec2& direction, float maxT,
+                                                                           HitTest hit) const;
+
+   /// Four queries along origin + t * direction, t in [0, maxT], in structure-of-arrays layout
+   struct Packet {
+      alignas(16) float originX[4];
+      alignas(16) float originY[4];
+      alignas(16) float directionX[4];
+      alignas(16) float directionY[4];
+      alignas(16) float inverseX[4];
+      alignas(16) float inverseY[4];
+      alignas(16) float maxT[4];
+   };
+
+   void packet_closest_hits(const Packet& packet, int activeLanes, Hit results[4]) const;
 };
 
 // Utility functions for intersection tests
@@ -92,3 +154,7 @@ std::optional<std::pair<float, float>> intersect_ray_aabb(const Ray& ray, const
 
 /// Check if a segment intersects an AABB.
 bool intersect_segment_aabb(const Segment& segment, const AABB& aabb);
+
+/// Entry parameter of origin + t * direction into a box (min.x, min.y, max.x, max.y), for t in [0, maxT].
+/// Returns None if the box is missed within that range.
+std::optional<float> entry_t(const glm::vec2& origin, const glm::vec2& direction, const glm::vec4& box, float maxT);
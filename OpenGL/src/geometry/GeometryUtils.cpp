@@ -1,11 +1,15 @@
 #include "GeometryUtils.h"
 #include <functional>
 #include <algorithm>
+#include <array>
+#include <iostream>
 #include <limits>
+#include <numbers>
+#include <set>
 #include <cmath>
 #include <cstdlib>
+#include <unordered_set>
 #include "earcut.hpp"
-#include "rendering/Renderer.h"
 
 namespace GeometryUtils {
 
@@ -34,7 +38,165 @@ bool findPolygonUnion(const std::vector<std::vector<glm::vec2>>& polygons, PolyT
    return clipper.Execute(ClipType::Union, FillRule::Positive, output);
 }
 
-PathsD FlattenPolyPathD(const PolyPathD& polyPath) {
+void findGridUnion(const std::vector<glm::ivec2>& cells, PolyTreeD& output) {
+   std::unordered_set<glm::ivec2> filled(cells.begin(), cells.end());
+
+   // Collect the cell sides facing empty cells, counter-clockwise around each cell so the cells are on the left
+   std::unordered_map<glm::ivec4, int> edges;
+   for (const auto& cell : filled) {
+      glm::ivec2 center = cell * 2;
+      if (!filled.contains(cell + glm::ivec2{0, -1})) {
+         edges[glm::ivec4(center + glm::ivec2{-1, -1}, center + glm::ivec2{1, -1})]++;
+      }
+      if (!filled.contains(cell + glm::ivec2{1, 0})) {
+         edges[glm::ivec4(center + glm::ivec2{1, -1}, center + glm::ivec2{1, 1})]++;
+      }
+      if (!filled.contains(cell + glm::ivec2{0, 1})) {
+         edges[glm::ivec4(center + glm::ivec2{1, 1}, center + glm::ivec2{-1, 1})]++;
+      }
+      if (!filled.contains(cell + glm::ivec2{-1, 0})) {
+         edges[glm::ivec4(center + glm::ivec2{-1, 1}, center + glm::ivec2{-1, -1})]++;
+      }
+   }
+   PathsD loops = TraceGridLoops(edges);
+
+   // Outlines go counter-clockwise and holes clockwise. Nest each loop in the smallest loop of the other kind that
+   // contains a point just inside it, going from the largest loop to the smallest so parents are placed first.
+   struct Loop {
+      PathD      path;
+      double     area;
+      PointD     inside;
+      PolyPathD* node;
+   };
+   std::vector<Loop> sorted;
+   sorted.reserve(loops.size());
+   for (auto& path : loops) {
+      PointD a         = path[0];
+      PointD b         = path[1];
+      double length    = std::hypot(b.x - a.x, b.y - a.y);
+      PointD direction = {(b.x - a.x) / length, (b.y - a.y) / length};
+      // a quarter tile to the left of the middle of the first tile side is inside the loop
+      PointD inside = {a.x + direction.x * 0.5 - direction.y * 0.25, a.y + direction.y * 0.5 + direction.x * 0.25};
+      double area   = Area(path);
+      sorted.push_back(Loop{std::move(path), area, inside, nullptr});
+   }
+   std::sort(sorted.begin(), sorted.end(),
+             [](const Loop& a, const Loop& b) { return std::abs(a.area) > std::abs(b.area); });
+
+
+   // Vertical loop sides by the rows of tiles they run along. The inside points are never at a tile corner's height, so
+   // a loop contains one if a ray going left from it crosses the loop's sides in that row an odd number of times.
+   std::unordered_map<long, std::vector<std::pair<double, size_t>>> rowSides;
+   for (size_t i = 0; i < sorted.size(); i++) {
+      const PathD& path = sorted[i].path;
+      for (size_t k = 0; k < path.size(); k++) {
+         const PointD& a = path[k];
+         const PointD& b = path[(k + 1) % path.size()];
+         if (a.x == b.x) {
+            long first = std::lround(std::min(a.y, b.y) + 0.5);
+            long last  = std::lround(std::max(a.y, b.y) - 0.5);
+            for (long row = first; row <= last; row++) {
+               rowSides[row].emplace_back(a.x, i);
+            }
+         }
+      }
+   }
+
+   std::vector<size_t> crossed;
+   for (size_t i = 0; i < sorted.size(); i++) {
+      crossed.clear();
+      if (auto row = rowSides.find(std::lround(sorted[i].inside.y)); row != rowSides.end()) {
+         for (auto [x, j] : row->second) {
+            if (j < i && x < sorted[i].inside.x && (sorted[j].area > 0) != (sorted[i].area > 0)) {
+               crossed.push_back(j);
+            }
+         }
+      }
+      std::sort(crossed.begin(), crossed.end());
+
+      // The smallest containing loop is the last one crossed an odd number of times
+      PolyPathD* parent = &output;
+      for (size_t k = 0; k < crossed.size();) {
+         size_t end = std::upper_bound(crossed.begin() + k, crossed.end(), crossed[k]) - crossed.begin();
+         if ((end - k) % 2 == 1) {
+            parent = sorted[crossed[k]].node;
+         }
+         k = end;
+      }
+      sorted[i].node = parent->AddChild(sorted[i].path);
+   }
+}
+
+std::vector<std::vector<glm::ivec2>> TraceGridCorners(const std::unordered_map<glm::ivec4, int>& edges) {
+   std::unordered_map<glm::ivec2, std::vector<glm::ivec2>> outgoing;
+   for (const auto& [edge, count] : edges) {
+      for (int i = 0; i < count; i++) {
+         outgoing[glm::ivec2(edge.x, edge.y)].push_back(glm::ivec2(edge.z, edge.w));
+      }
+   }
+
+   // Where two loops touch at a corner, keep turning left so they stay separate loops
+   auto turnRank = [](glm::ivec2 direction, glm::ivec2 next) {
+      int turn = direction.x * next.y - direction.y * next.x;
+      if (turn != 0) {
+         return turn > 0 ? 0 : 2;
+      }
+      return glm::dot(glm::vec2(direction), glm::vec2(next)) >= 0 ? 1 : 3;
+   };
+
+   std::vector<std::vector<glm::ivec2>> result;
+   for (auto& [start, startEdges] : outgoing) {
+      while (!startEdges.empty()) {
+         std::vector<glm::ivec2> loop;
+         glm::ivec2              corner    = start;
+         glm::ivec2              direction = {0, 0};
+         do {
+            auto candidates = outgoing.find(corner);
+            if (candidates == outgoing.end() || candidates->second.empty()) {
+               break;
+            }
+            auto& next = candidates->second;
+            auto  best = std::min_element(next.begin(), next.end(), [&](glm::ivec2 a, glm::ivec2 b) {
+               return turnRank(direction, a - corner) < turnRank(direction, b - corner);
+            });
+            loop.push_back(corner);
+            direction = *best - corner;
+            corner    = *best;
+            next.erase(best);
+         } while (corner != start);
+         result.push_back(std::move(loop));
+      }
+   }
+   return result;
+}
+
+PathD SimplifyGridLoop(const std::vector<glm::ivec2>& loop) {
+   // Drop the corners in the middle of straight runs
+   PathD path;
+   for (size_t i = 0; i < loop.size(); i++) {
+      glm::ivec2 previous = loop[(i + loop.size() - 1) % loop.size()];
+      glm::ivec2 next     = loop[(i + 1) % loop.size()];
+      glm::ivec2 in       = loop[i] - previous;
+      glm::ivec2 out      = next - loop[i];
+      if (in.x * out.y - in.y * out.x != 0 || glm::dot(glm::vec2(in), glm::vec2(out)) < 0) {
+         path.emplace_back(loop[i].x * 0.5, loop[i].y * 0.5);
+      }
+   }
+   return path;
+}
+
+PathsD TraceGridLoops(const std::unordered_map<glm::ivec4, int>& edges) {
+   PathsD result;
+   for (const auto& loop : TraceGridCorners(edges)) {
+      PathD path = SimplifyGridLoop(loop);
+      if (path.size() >= 3) {
+         result.push_back(std::move(path));
+      }
+   }
+   return result;
+}
+
+PathsD FlattenPolyPathD(const PolyPathD& polyPath, bool simplify) {
    PathsD paths;
 
    // Lambda function for recursive traversal
@@ -53,7 +215,9 @@ PathsD FlattenPolyPathD(const PolyPathD& polyPath) {
    // Start traversal from the root node
    traverse(polyPath);
 
-   paths = SimplifyPaths(paths, 0.025);
+   if (simplify) {
+      paths = SimplifyPaths(paths, 0.025);
+   }
 
    return paths;
 }
@@ -185,7 +349,7 @@ Side pointSide(const glm::vec2& point, const glm::vec2& linePoint, const glm::ve
    }
 }
 
-PathD ComputeVisibilityPolygon(const glm::vec2& position, const PathsD& obstacles, const BVH& bvh) {
+PathD ComputeVisibilityPolygonReference(const glm::vec2& position, const PathsD& obstacles, const BVH& bvh) {
    enum class PointType { Start, End, Middle };
 
    struct TaggedPoint {
@@ -301,4 +465,173 @@ PathD ComputeVisibilityPolygon(const glm::vec2& position, const PathsD& obstacle
    return path;
 }
 
+PathD ComputeVisibilityPolygon(const glm::vec2& position, const std::vector<Segment>& segments) {
+   constexpr double pi = std::numbers::pi;
+
+   struct SweepSegment {
+      glm::dvec2 start; // clockwise end as seen from the position
+      glm::dvec2 end;   // counter-clockwise end
+      double     startAngle;
+      double     endAngle;
+   };
+
+   glm::dvec2 origin(position);
+   auto       angle  = [&](glm::dvec2 point) { return std::atan2(point.y - origin.y, point.x - origin.x); };
+   auto       cross2 = [](glm::dvec2 a, glm::dvec2 b) { return a.x * b.y - a.y * b.x; };
+
+   // Box around everything so every direction hits something. Empty segments (e.g. unused slots of WallChunks) don't
+   // block anything.
+   glm::dvec2 min = origin;
+   glm::dvec2 max = origin;
+   for (const auto& segment : segments) {
+      if (segment.start == segment.end) {
+         continue;
+      }
+      min = glm::min(min, glm::min(glm::dvec2(segment.start), glm::dvec2(segment.end)));
+      max = glm::max(max, glm::max(glm::dvec2(segment.start), glm::dvec2(segment.end)));
+   }
+   min -= 1.0;
+   max += 1.0;
+   std::vector<std::pair<glm::dvec2, glm::dvec2>> lines = {
+      {{min.x, min.y}, {max.x, min.y}},
+      {{max.x, min.y}, {max.x, max.y}},
+      {{max.x, max.y}, {min.x, max.y}},
+      {{min.x, max.y}, {min.x, min.y}},
+   };
+   for (const auto& segment : segments) {
+      if (segment.start != segment.end) {
+         lines.emplace_back(segment.start, segment.end);
+      }
+   }
+
+   // Orient every segment counter-clockwise around the position, splitting the ones that cross the ray pointing
+   // towards -x, where the angles wrap from pi to -pi
+   std::vector<SweepSegment> sweepSegments;
+   sweepSegments.reserve(lines.size() + 4);
+   auto add = [&](glm::dvec2 start, glm::dvec2 end, double fromAngle, double toAngle) {
+      if (toAngle > fromAngle) {
+         sweepSegments.push_back(SweepSegment{start, end, fromAngle, toAngle});
+      }
+   };
+   for (auto [a, b] : lines) {
+      double turn = cross2(a - origin, b - origin);
+      if (std::abs(turn) < 1e-12) {
+         continue; // seen edge-on
+      }
+      if (turn < 0) {
+         std::swap(a, b);
+      }
+      double startAngle = angle(a);
+      double endAngle   = angle(b);
+      if (a.y == origin.y && a.x < origin.x) {
+         startAngle = -pi;
+      }
+      if (b.y == origin.y && b.x < origin.x) {
+         endAngle = pi;
+      }
+      if (endAngle > startAngle) {
+         add(a, b, startAngle, endAngle);
+      } else {
+         double     t     = (origin.y - a.y) / (b.y - a.y);
+         glm::dvec2 split = {a.x + t * (b.x - a.x), origin.y};
+         add(a, split, startAngle, pi);
+         add(split, b, -pi, endAngle);
+      }
+   }
+
+   // Distance from the position to a segment along the ray at the given angle
+   auto distanceAt = [&](const SweepSegment& segment, double rayAngle) {
+      glm::dvec2 direction = {std::cos(rayAngle), std::sin(rayAngle)};
+      glm::dvec2 edge      = segment.end - segment.start;
+      double     denom     = cross2(direction, edge);
+      if (std::abs(denom) < 1e-12) {
+         return std::min(glm::length(segment.start - origin), glm::length(segment.end - origin));
+      }
+      return cross2(segment.start - origin, edge) / denom;
+   };
+
+   struct Event {
+      double angle;
+      bool   start;
+      size_t segment;
+   };
+   std::vector<Event> events;
+   events.reserve(sweepSegments.size() * 2);
+   for (size_t i = 0; i < sweepSegments.size(); i++) {
+      events.push_back(Event{sweepSegments[i].startAngle, true, i});
+      events.push_back(Event{sweepSegments[i].endAngle, false, i});
+   }
+   std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.angle < b.angle; });
+
+   // Active segments ordered by distance along the sweep ray. Active segments don't cross, so their order stays the
+   // same while the ray rotates and can be compared at any angle they all span.
+   double sweepAngle = -pi;
+   auto   closer     = [&](size_t a, size_t b) {
+      double distanceA = distanceAt(sweepSegments[a], sweepAngle);
+      double distanceB = distanceAt(sweepSegments[b], sweepAngle);
+      return distanceA != distanceB ? distanceA < distanceB : a < b;
+   };
+   std::set<size_t, decltype(closer)>      active(closer);
+   std::vector<decltype(active)::iterator> handles(sweepSegments.size());
+
+   PathD polygon;
+   auto  emit = [&](size_t segment, double rayAngle) {
+      double     distance = distanceAt(sweepSegments[segment], rayAngle);
+      glm::dvec2 point    = origin + distance * glm::dvec2(std::cos(rayAngle), std::sin(rayAngle));
+      if (polygon.empty() || polygon.back().x != point.x || polygon.back().y != point.y) {
+         polygon.emplace_back(point.x, point.y);
+      }
+   };
+
+   for (size_t i = 0; i < events.size();) {
+      double eventAngle = events[i].angle;
+      size_t groupEnd   = i;
+      // Corners at the same angle can come out of atan2 a rounding error apart. They are handled together, so the
+      // active segments are only ever compared well away from where they start or end.
+      while (groupEnd < events.size() && events[groupEnd].angle - eventAngle <= 1e-12) {
+         groupEnd++;
+      }
+      double nextAngle = groupEnd < events.size() ? events[groupEnd].angle : pi;
+
+      std::optional<size_t> closestBefore;
+      if (!active.empty()) {
+         closestBefore = *active.begin();
+      }
+
+      for (size_t j = i; j < groupEnd; j++) {
+         if (!events[j].start) {
+            active.erase(handles[events[j].segment]);
+         }
+      }
+      sweepAngle = (eventAngle + nextAngle) / 2;
+      for (size_t j = i; j < groupEnd; j++) {
+         if (events[j].start) {
+            handles[events[j].segment] = active.insert(events[j].segment).first;
+         }
+      }
+
+      std::optional<size_t> closestAfter;
+      if (!active.empty()) {
+         closestAfter = *active.begin();
+      }
+
+      // The visible boundary jumps from one segment to another at this angle
+      if (closestBefore != closestAfter) {
+         if (closestBefore) {
+            emit(*closestBefore, eventAngle);
+         }
+         if (closestAfter) {
+            emit(*closestAfter, eventAngle);
+         }
+      }
+      i = groupEnd;
+   }
+
+   // The sweep starts and ends on the same ray
+   if (polygon.size() > 1 && polygon.front() == polygon.back()) {
+      polygon.pop_back();
+   }
+   return polygon;
+}
+
 } // namespace GeometryUtils
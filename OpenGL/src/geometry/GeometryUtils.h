@@ -3,8 +3,13 @@
 #include <vector>
 #include <functional>
 #include <optional>
+#include <unordered_map>
 #include "clipper2/clipper.h"
 #include <glm/glm.hpp>
+#ifndef GLM_ENABLE_EXPERIMENTAL
+#define GLM_ENABLE_EXPERIMENTAL
+#endif
+#include <glm/gtx/hash.hpp>
 #include "earcut.hpp"
 #include "geometry/BVH.h"
 
@@ -20,22 +25,67 @@ using namespace Clipper2Lib;
  */
 bool findPolygonUnion(const std::vector<std::vector<glm::vec2>>& polygons, PolyTreeD& output);
 
+/**
+ * @brief Finds the union of unit squares centered on integer grid cells (e.g. wall tiles) by tracing the cell sides
+ * that don't touch another cell. Produces the same outlines and holes as findPolygonUnion on the squares, already
+ * simplified, without general-purpose clipping. Use findPolygonUnion for anything not on the grid.
+ *
+ * @param cells The filled grid cells.
+ * @param output A PolyTreeD object to store the resulting union.
+ */
+void findGridUnion(const std::vector<glm::ivec2>& cells, PolyTreeD& output);
+
+/**
+ * @brief Traces directed edges on the half-unit grid into closed loops.
+ *
+ * @param edges Directed edges (from.x, from.y, to.x, to.y) in doubled coordinates, so that tile corners are integers,
+ * mapped to how often they occur. The filled region should be on the left of each edge.
+ * @return PathsD The loops in world coordinates, without the corners in the middle of straight runs.
+ */
+PathsD TraceGridLoops(const std::unordered_map<glm::ivec4, int>& edges);
+
+/**
+ * @brief The loops TraceGridLoops is made of, as every corner they pass in doubled coordinates. Each loop is closed,
+ * the first corner follows the last.
+ */
+std::vector<std::vector<glm::ivec2>> TraceGridCorners(const std::unordered_map<glm::ivec4, int>& edges);
+
+/**
+ * @brief Turns a loop from TraceGridCorners into a path in world coordinates, dropping the corners in the middle of
+ * straight runs.
+ */
+PathD SimplifyGridLoop(const std::vector<glm::ivec2>& loop);
+
 /**
  * @brief Flattens a hierarchical PolyPathD into a simple PathsD structure.
  *
  * @param polyPath The root PolyPathD to flatten.
+ * @param simplify Whether to simplify the paths (not needed for paths that are already simple, e.g. from
+ * findGridUnion).
  * @return PathsD A flattened PathsD containing all polygons from the hierarchy.
  */
-PathsD FlattenPolyPathD(const PolyPathD& polyPath);
+PathsD FlattenPolyPathD(const PolyPathD& polyPath, bool simplify = true);
+
+/**
+ * @brief Computes the visibility polygon from a given position with an angular sweep around it, keeping the segments
+ * crossing the sweep ray ordered by distance. Runs in O(n log n) without any BVH queries.
+ *
+ * @param position The player's position as glm::vec2.
+ * @param segments The segments blocking sight (e.g. BVH::segments of the walls).
+ * @return PathD The visibility polygon as a vector of points, bounded by a box around the segments.
+ */
+PathD ComputeVisibilityPolygon(const glm::vec2& position, const std::vector<Segment>& segments);
 
 /**
- * @brief Computes the visibility polygon from a given position and obstacles.
+ * @brief Computes the visibility polygon from a given position and obstacles by casting rays at every obstacle vertex.
+ * Slower reference implementation of ComputeVisibilityPolygon, only kept as the oracle of tests/VisibilityTest.cpp. It
+ * makes one BVH::segment_intersect / ray_intersect per vertex, so it doesn't depend on the packet traversal either.
  *
  * @param position The player's position as glm::vec2.
  * @param obstacles The obstacles represented as PathsD (vector of paths).
  * @return PathD The visibility polygon as a vector of points.
  */
-PathD ComputeVisibilityPolygon(const glm::vec2& position, const PathsD& obstacles, const BVH& bvh);
+PathD ComputeVisibilityPolygonReference(const glm::vec2& position, const PathsD& obstacles, const BVH& bvh);
 
 /**
  * @brief Computes the intersection point between a ray and a line segment.
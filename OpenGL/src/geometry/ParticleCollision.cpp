@@ -0,0 +1,128 @@
+#include "ParticleCollision.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace ParticleCollision {
+
+namespace {
+
+float cross2D(glm::vec2 a, glm::vec2 b) {
+   return a.x * b.y - a.y * b.x;
+}
+
+// Where origin + t * direction enters the box for t in [0, 1], or -1 if it misses
+float entryT(glm::vec2 origin, glm::vec2 inverseDirection, const glm::vec4& box) {
+   glm::vec2 t0   = (glm::vec2(box.x, box.y) - origin) * inverseDirection;
+   glm::vec2 t1   = (glm::vec2(box.z, box.w) - origin) * inverseDirection;
+   glm::vec2 near = glm::min(t0, t1);
+   glm::vec2 far  = glm::max(t0, t1);
+   float     tmin = std::max(std::max(near.x, near.y), 0.0f);
+   float     tmax = std::min(std::min(far.x, far.y), 1.0f);
+   return tmin <= tmax ? tmin : -1.0f;
+}
+
+void testBucket(const BVH& bvh, const Segment& path, uint32_t offset, uint32_t count, WallCollision& closest) {
+   for (uint32_t i = 0; i < count; i++) {
+      auto intersection = intersectWall(path, bvh.segments[offset + i]);
+      if (intersection.hit && intersection.t < closest.t) {
+         closest = intersection;
+      }
+   }
+}
+
+} // namespace
+
+WallCollision intersectWall(const Segment& path, const Segment& wall) {
+   WallCollision result;
+
+   glm::vec2 p = path.start;
+   glm::vec2 r = path.end - path.start;
+   glm::vec2 q = wall.start;
+   glm::vec2 s = wall.end - wall.start;
+
+   float     rCrossS = cross2D(r, s);
+   glm::vec2 qp      = q - p;
+   if (std::abs(rCrossS) < 1e-8f) {
+      return result; // Lines are parallel
+   }
+
+   float t = cross2D(qp, s) / rCrossS;
+   float u = cross2D(qp, r) / rCrossS;
+   if (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f) {
+      result.hit      = true;
+      result.t        = t;
+      result.position = p + t * r;
+      result.normal   = glm::normalize(glm::vec2(-s.y, s.x));
+   }
+   return result;
+}
+
+WallCollision findWallCollision(const BVH& bvh, glm::vec2 from, glm::vec2 to) {
+   WallCollision closest;
+   if (bvh.nodes.empty()) {
+      return closest;
+   }
+
+   Segment   path{from, to};
+   glm::vec2 direction = to - from;
+   // Nudge zero direction components so the slab test never divides by zero, like the shader does
+   glm::vec2 inverseDirection(1.0f / (std::abs(direction.x) < 1e-8f ? 1e-8f : direction.x),
+                              1.0f / (std::abs(direction.y) < 1e-8f ? 1e-8f : direction.y));
+
+   std::array<std::pair<uint32_t, float>, BVH_STACK_SIZE> stack;
+   size_t                                                 stackSize = 0;
+   stack[stackSize++] = {static_cast<uint32_t>(bvh.nodes.size() - 1), 0.0f};
+
+   while (stackSize > 0) {
+      auto [nodeIndex, nodeT] = stack[--stackSize];
+      if (nodeT >= closest.t) {
+         continue;
+      }
+      const BvhNode& node = bvh.nodes[nodeIndex];
+
+      struct Child {
+         uint32_t type, count, offset;
+         float    t;
+      };
+      Child near{node.getLeftType(), node.getLeftCount(), node.leftOffset,
+                 entryT(from, inverseDirection, node.leftBBox)};
+      Child far{node.getRightType(), node.getRightCount(), node.rightOffset, -1.0f};
+      if (node.rightBBox != glm::vec4(0.0f)) {
+         far.t = entryT(from, inverseDirection, node.rightBBox);
+      }
+      if (far.t >= 0.0f && (near.t < 0.0f || far.t < near.t)) {
+         std::swap(near, far);
+      }
+
+      // Buckets are tested right away, nodes are pushed far first so the near one is popped first
+      for (const Child& child : {near, far}) {
+         if (child.type == 1 && child.t >= 0.0f && child.t < closest.t) {
+            testBucket(bvh, path, child.offset, child.count, closest);
+         }
+      }
+      for (const Child& child : {far, near}) {
+         if (child.type == 0 && child.t >= 0.0f && child.t < closest.t && stackSize < BVH_STACK_SIZE) {
+            stack[stackSize++] = {child.offset, child.t};
+         }
+      }
+   }
+   return closest;
+}
+
+void step(const BVH& bvh, glm::vec2& position, glm::vec2& velocity, float& age, float deltaTime) {
+   glm::vec2 newPosition  = position + velocity * deltaTime;
+   auto      intersection = findWallCollision(bvh, position, newPosition);
+   if (intersection.hit) {
+      glm::vec2 n         = intersection.normal;
+      glm::vec2 reflected = velocity - 2.0f * glm::dot(velocity, n) * n;
+      velocity            = reflected * BOUNCE;
+      position            = intersection.position + velocity * deltaTime;
+   } else {
+      position = newPosition;
+   }
+   age += deltaTime;
+}
+
+} // namespace ParticleCollision
@@ -0,0 +1,29 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "BVH.h"
+
+// CPU version of the particle kernel in res/shaders/particlesCompute.wgsl and the BVH walk in res/shaders/bvh.wgsl.
+// It follows the shaders step by step (same traversal order, same float math), which makes it the reference the tests
+// check the BVH walk (tests/ParticleCollisionTest.cpp) and the CPU backend (tests/ParticleSimulationTest.cpp) against.
+namespace ParticleCollision {
+
+struct WallCollision {
+   bool      hit = false;
+   glm::vec2 position{};
+   glm::vec2 normal{};
+   float     t = 999999.0f; // Along the path, 0 at `from` and 1 at `to`
+};
+
+// Bounce coefficient used by the compute shader (1.0 = perfect bounce, 0.0 = full stop)
+constexpr float BOUNCE = 0.2f;
+
+// Intersection of the path with one wall, with t along the path and the normal of the wall
+WallCollision intersectWall(const Segment& path, const Segment& wall);
+
+// Closest wall hit on the way from `from` to `to`
+WallCollision findWallCollision(const BVH& bvh, glm::vec2 from, glm::vec2 to);
+
+// One step of compute_main: move, bounce off walls and age
+void step(const BVH& bvh, glm::vec2& position, glm::vec2& velocity, float& age, float deltaTime);
+
+} // namespace ParticleCollision
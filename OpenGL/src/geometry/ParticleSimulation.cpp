@@ -0,0 +1,289 @@
+#include "ParticleSimulation.h"
+#include <algorithm>
+#include <array>
+#include <span>
+#include "ParticleCollision.h"
+
+#ifndef __EMSCRIPTEN__
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_USE_SSE
+#include <emmintrin.h>
+#endif
+
+void ParticleState::add(glm::vec2 position, glm::vec2 velocity, glm::vec4 particleColor, float particleAge,
+                        float particleLifetime) {
+   if (live == size()) {
+      positionX.push_back(position.x);
+      positionY.push_back(position.y);
+      velocityX.push_back(velocity.x);
+      velocityY.push_back(velocity.y);
+      age.push_back(particleAge);
+      lifetime.push_back(particleLifetime);
+      color.push_back(particleColor);
+   } else {
+      // Reuse the first free slot
+      positionX[live] = position.x;
+      positionY[live] = position.y;
+      velocityX[live] = velocity.x;
+      velocityY[live] = velocity.y;
+      age[live]       = particleAge;
+      lifetime[live]  = particleLifetime;
+      color[live]     = particleColor;
+   }
+   live++;
+}
+
+void ParticleState::clear() {
+   positionX.clear();
+   positionY.clear();
+   velocityX.clear();
+   velocityY.clear();
+   age.clear();
+   lifetime.clear();
+   color.clear();
+   live = 0;
+}
+
+namespace ParticleSimulation {
+
+namespace {
+
+// Particles per wall query batch, small enough to keep the queries on the stack
+constexpr size_t BATCH_SIZE = 256;
+
+// to[i] = from[i] + step[i] * scale for i in [0, count)
+void multiplyAdd(const float* from, const float* step, float scale, float* to, size_t count) {
+   size_t i = 0;
+#ifdef PARTICLES_USE_SSE
+   __m128 scale4 = _mm_set1_ps(scale);
+   for (; i + 4 <= count; i += 4) {
+      __m128 value = _mm_add_ps(_mm_loadu_ps(from + i), _mm_mul_ps(_mm_loadu_ps(step + i), scale4));
+      _mm_storeu_ps(to + i, value);
+   }
+#endif
+   for (; i < count; i++) {
+      to[i] = from[i] + step[i] * scale;
+   }
+}
+
+// values[i] += amount for i in [0, count)
+void addScalar(float* values, float amount, size_t count) {
+   size_t i = 0;
+#ifdef PARTICLES_USE_SSE
+   __m128 amount4 = _mm_set1_ps(amount);
+   for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(values + i, _mm_add_ps(_mm_loadu_ps(values + i), amount4));
+   }
+#endif
+   for (; i < count; i++) {
+      values[i] += amount;
+   }
+}
+
+// PCG hash, the same one the emit kernel uses
+uint32_t pcgHash(uint32_t value) {
+   uint32_t state = value * 747796405u + 2891336453u;
+   uint32_t word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+   return (word >> 22u) ^ word;
+}
+
+// Next random number in [0, 1), advancing `state`
+float nextRandom(uint32_t& state) {
+   state = pcgHash(state);
+   return static_cast<float>(state >> 8u) / 16777216.0f;
+}
+
+#ifndef __EMSCRIPTEN__
+// Threads that live as long as the program and wait for work, so a frame doesn't pay for starting and joining threads
+class WorkerPool {
+public:
+   explicit WorkerPool(size_t count) {
+      for (size_t i = 0; i < count; i++) {
+         workers.emplace_back([this, i] { work(i + 1); });
+      }
+   }
+
+   ~WorkerPool() {
+      {
+         std::lock_guard lock(mutex);
+         stopping = true;
+      }
+      wake.notify_all();
+      // The workers are joined when they go out of scope
+   }
+
+   // Threads that can work on a job, counting the calling thread
+   size_t threads() const { return workers.size() + 1; }
+
+   // Calls job(0) on the calling thread and job(1) ... job(parts - 1) on workers, returning once all are done
+   void run(size_t parts, const std::function<void(size_t)>& job) {
+      {
+         std::lock_guard lock(mutex);
+         current = &job;
+         active  = parts;
+         pending = parts - 1;
+         generation++;
+      }
+      wake.notify_all();
+      job(0);
+      std::unique_lock lock(mutex);
+      done.wait(lock, [&] { return pending == 0; });
+   }
+
+private:
+   void work(size_t part) {
+      uint64_t seen = 0;
+      while (true) {
+         const std::function<void(size_t)>* job;
+         {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+               return;
+            }
+            seen = generation;
+            if (part >= active) {
+               continue;
+            }
+            job = current;
+         }
+         (*job)(part);
+         std::lock_guard lock(mutex);
+         if (--pending == 0) {
+            done.notify_one();
+         }
+      }
+   }
+
+   std::mutex                         mutex;
+   std::condition_variable            wake;
+   std::condition_variable            done;
+   const std::function<void(size_t)>* current    = nullptr;
+   size_t                             active     = 0;
+   size_t                             pending    = 0;
+   uint64_t                           generation = 0;
+   bool                               stopping   = false;
+   std::vector<std::jthread>          workers; // Last, so they're joined before the rest goes away
+};
+
+WorkerPool& workerPool() {
+   static WorkerPool pool(std::max<size_t>(1, std::thread::hardware_concurrency()) - 1);
+   return pool;
+}
+#endif
+
+} // namespace
+
+void step(ParticleState& state, const BVH& bvh, float deltaTime, size_t begin, size_t end) {
+   std::array<float, BATCH_SIZE>    newX;
+   std::array<float, BATCH_SIZE>    newY;
+   std::array<Segment, BATCH_SIZE>  paths;
+   std::array<BVH::Hit, BATCH_SIZE> hits;
+
+   for (size_t first = begin; first < end; first += BATCH_SIZE) {
+      size_t count = std::min(BATCH_SIZE, end - first);
+
+      // New positions based on current velocity
+      multiplyAdd(&state.positionX[first], &state.velocityX[first], deltaTime, newX.data(), count);
+      multiplyAdd(&state.positionY[first], &state.velocityY[first], deltaTime, newY.data(), count);
+
+      // Check for collisions with walls
+      for (size_t i = 0; i < count; i++) {
+         paths[i] = Segment{
+            glm::vec2(state.positionX[first + i], state.positionY[first + i]),
+            glm::vec2(newX[i], newY[i]),
+         };
+      }
+      bvh.segment_intersect_batch(std::span<const Segment>(paths.data(), count),
+                                  std::span<BVH::Hit>(hits.data(), count));
+
+      for (size_t i = 0; i < count; i++) {
+         size_t index = first + i;
+         if (!hits[i]) {
+            state.positionX[index] = newX[i];
+            state.positionY[index] = newY[i];
+            continue;
+         }
+
+         // Reflect off the wall and lose most of the speed, like the shader
+         auto [position, wall] = *hits[i];
+         glm::vec2 s           = wall->end - wall->start;
+         glm::vec2 n           = glm::normalize(glm::vec2(-s.y, s.x));
+         glm::vec2 v(state.velocityX[index], state.velocityY[index]);
+         glm::vec2 velocity     = (v - 2.0f * glm::dot(v, n) * n) * ParticleCollision::BOUNCE;
+         glm::vec2 placed       = position + velocity * deltaTime;
+         state.velocityX[index] = velocity.x;
+         state.velocityY[index] = velocity.y;
+         state.positionX[index] = placed.x;
+         state.positionY[index] = placed.y;
+      }
+
+      addScalar(&state.age[first], deltaTime, count);
+   }
+}
+
+void stepAll(ParticleState& state, const BVH& bvh, float deltaTime) {
+   size_t total = state.live;
+#ifndef __EMSCRIPTEN__
+   size_t threadCount = std::min(workerPool().threads(), total / PARALLEL_THRESHOLD);
+   if (threadCount > 1) {
+      // Ranges are whole batches, so threads only meet at batch boundaries
+      size_t perThread = ((total + threadCount - 1) / threadCount + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+      workerPool().run(threadCount, [&](size_t part) {
+         size_t begin = std::min(total, part * perThread);
+         step(state, bvh, deltaTime, begin, std::min(total, begin + perThread));
+      });
+      return;
+   }
+#endif
+   step(state, bvh, deltaTime, 0, total);
+}
+
+void emit(ParticleState& state, const ParticleEmitter& emitter, size_t capacity) {
+   for (uint32_t index = 0; index < emitter.count && state.live < capacity; index++) {
+      // Drawn one at a time, in the same order as the emit kernel
+      uint32_t random  = pcgHash(emitter.seed + index * 0x9E3779B9u);
+      float    offsetX = nextRandom(random) * 2.0f - 1.0f;
+      float    offsetY = nextRandom(random) * 2.0f - 1.0f;
+      float    jitterX = nextRandom(random) - 0.5f;
+      float    jitterY = nextRandom(random) - 0.5f;
+      float    scale   = 1.0f + (nextRandom(random) * 2.0f - 1.0f) * emitter.lifetimeSpread;
+      float    red     = nextRandom(random);
+      float    green   = nextRandom(random);
+      float    blue    = nextRandom(random);
+      float    alpha   = nextRandom(random);
+
+      state.add(emitter.position + glm::vec2(offsetX, offsetY) * emitter.spread,
+                emitter.velocity + glm::vec2(jitterX, jitterY) * emitter.speed,
+                glm::mix(emitter.colorMin, emitter.colorMax, glm::vec4(red, green, blue, alpha)), 0.0f,
+                emitter.lifetime * scale);
+   }
+}
+
+void compact(ParticleState& state) {
+   size_t live = 0;
+   for (size_t i = 0; i < state.live; i++) {
+      if (state.age[i] >= state.lifetime[i]) {
+         continue;
+      }
+      if (live != i) {
+         state.positionX[live] = state.positionX[i];
+         state.positionY[live] = state.positionY[i];
+         state.velocityX[live] = state.velocityX[i];
+         state.velocityY[live] = state.velocityY[i];
+         state.age[live]       = state.age[i];
+         state.lifetime[live]  = state.lifetime[i];
+         state.color[live]     = state.color[i];
+      }
+      live++;
+   }
+   state.live = live;
+}
+
+} // namespace ParticleSimulation
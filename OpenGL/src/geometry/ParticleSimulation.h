@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.h"
+
+// Particle state in structure-of-arrays layout, so the CPU backend can move four particles per instruction.
+// Particles [0, live) are alive, the slots after them are free for new particles.
+struct ParticleState {
+   std::vector<float>     positionX;
+   std::vector<float>     positionY;
+   std::vector<float>     velocityX;
+   std::vector<float>     velocityY;
+   std::vector<float>     age;
+   std::vector<float>     lifetime;
+   std::vector<glm::vec4> color;
+   size_t                 live = 0;
+
+   size_t size() const { return positionX.size(); }
+   void   add(glm::vec2 position, glm::vec2 velocity, glm::vec4 color, float age, float lifetime);
+   void   clear();
+};
+
+// Spawn parameters of a burst of particles, laid out like `Emitter` in res/shaders/particlesCompute.wgsl. Every
+// particle gets its own random numbers from `seed` and its index in the burst, so the GPU and CPU spawn the same ones.
+struct ParticleEmitter {
+   glm::vec4 colorMin{1.0f};         // at byte offset 0, each channel is picked between colorMin and colorMax
+   glm::vec4 colorMax{1.0f};         // at byte offset 16
+   glm::vec2 position{};             // at byte offset 32
+   glm::vec2 spread{};               // at byte offset 40, half size of the area particles start in
+   glm::vec2 velocity{};             // at byte offset 48
+   float     speed          = 0.0f;  // at byte offset 56, adds a random velocity in [-speed / 2, speed / 2] per axis
+   float     lifetime       = 1.0f;  // at byte offset 60
+   float     lifetimeSpread = 0.0f;  // at byte offset 64, lifetimes vary by this fraction either way
+   uint32_t  count          = 0;     // at byte offset 68
+   uint32_t  seed           = 0;     // at byte offset 72
+   float     _pad0          = 0.0f;
+};
+
+// CPU backend of res/shaders/particlesCompute.wgsl. Positions and ages are integrated with SSE when available, the
+// wall tests go through the packet traversal of BVH::segment_intersect_batch and bounces use the same formula as the
+// shader, so results match the GPU up to float rounding (see ParticleCollision for a lane by lane copy of the shader).
+namespace ParticleSimulation {
+
+// Below this many particles a step runs on the calling thread only
+constexpr size_t PARALLEL_THRESHOLD = 4096;
+
+// Steps particles [begin, end)
+void step(ParticleState& state, const BVH& bvh, float deltaTime, size_t begin, size_t end);
+
+// Steps every live particle, split over a pool of worker threads when there are enough of them (and threads are
+// available). The workers are started on the first call and wait between calls. Only call it from one thread at a time.
+void stepAll(ParticleState& state, const BVH& bvh, float deltaTime);
+
+// Spawns the emitter's particles into the free slots, without growing the state past `capacity`
+void emit(ParticleState& state, const ParticleEmitter& emitter, size_t capacity);
+
+// Moves the particles that are still alive (age < lifetime) to the front, keeping their order, and updates `live`.
+// Same result as the compaction passes in res/shaders/particlesCompute.wgsl.
+void compact(ParticleState& state);
+
+} // namespace ParticleSimulation
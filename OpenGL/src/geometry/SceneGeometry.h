@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 #include "clipper2/clipper.h"
@@ -7,10 +8,17 @@
 class SceneGeometry {
 public:
    struct WallResult {
-      std::vector<std::vector<glm::vec2>>     allBounds;
+      // Wall outlines (counter-clockwise) and holes (clockwise), with empty paths where outlines were removed
+      Clipper2Lib::PathsD                        flattened;
+      std::vector<const Clipper2Lib::PolyTreeD*> wallPaths; // One tree per chunk of walls
+      BVH                                        bvh;
+   };
+
+   // Inside the outer outline of the walls but not in a wall, i.e. where fog can be. Derived once per wall change (see
+   // computeOpenArea) so the fog only has to clip the visibility polygon out of it.
+   struct OpenArea {
+      std::unique_ptr<Clipper2Lib::PolyTreeD> tree;
       Clipper2Lib::PathsD                     flattened;
-      std::unique_ptr<Clipper2Lib::PolyTreeD> wallPaths;
-      BVH                                     bvh;
    };
 
    struct VisibilityResult {
@@ -18,9 +26,9 @@ public:
       std::unique_ptr<Clipper2Lib::PolyTreeD> invisibilityPaths;
    };
 
-   static WallResult computeWallPaths();
-
-   static VisibilityResult computeVisibility(SceneGeometry::WallResult& wallResult, const glm::vec2& playerPosition);
+   static VisibilityResult computeVisibility(const SceneGeometry::WallResult& wallResult,
+                                             const SceneGeometry::OpenArea&   openArea,
+                                             const glm::vec2&                 playerPosition);
 
-private:
+   static OpenArea computeOpenArea(const SceneGeometry::WallResult& wallResult);
 };
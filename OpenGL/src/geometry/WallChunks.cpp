@@ -0,0 +1,286 @@
+#include "WallChunks.h"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include "GeometryUtils.h"
+
+using namespace Clipper2Lib;
+using namespace GeometryUtils;
+
+namespace {
+
+const Segment EMPTY_SEGMENT = {glm::vec2(0.0f), glm::vec2(0.0f)};
+
+// The side of a tile facing `direction`, counter-clockwise around the tile, in doubled coordinates (see
+// TraceGridLoops)
+glm::ivec4 tileSide(glm::ivec2 tile, glm::ivec2 direction) {
+   glm::ivec2 middle = tile * 2 + direction;
+   glm::ivec2 along  = {-direction.y, direction.x};
+   return glm::ivec4(middle - along, middle + along);
+}
+
+} // namespace
+
+glm::ivec2 WallChunks::chunkOf(glm::ivec2 tile) {
+   auto floorDiv = [](int value) { return (value >= 0 ? value : value - CHUNK_SIZE + 1) / CHUNK_SIZE; };
+   return {floorDiv(tile.x), floorDiv(tile.y)};
+}
+
+void WallChunks::clear() {
+   walls.clear();
+   chunks.clear();
+   dirtyChunks.clear();
+   changedTiles.clear();
+   assembled      = false;
+   assembledWalls = {};
+   topLevelNodes  = 0;
+   flatBuild      = false;
+   sideLoops.clear();
+   loops.clear();
+   freeLoops.clear();
+}
+
+void WallChunks::setWall(glm::ivec2 tile, bool wall) {
+   bool changed = wall ? walls.insert(tile).second : walls.erase(tile) > 0;
+   if (!changed) {
+      return;
+   }
+
+   auto  chunkPosition = chunkOf(tile);
+   auto& chunk         = chunks[chunkPosition];
+   if (wall) {
+      chunk.walls.push_back(tile);
+   } else {
+      std::erase(chunk.walls, tile);
+   }
+   dirtyChunks.insert(chunkPosition);
+   changedTiles.insert(tile);
+
+   // Neighbouring chunks keep or drop their border edges depending on the walls next to them
+   for (glm::ivec2 offset : {glm::ivec2{1, 0}, glm::ivec2{-1, 0}, glm::ivec2{0, 1}, glm::ivec2{0, -1}}) {
+      auto neighbour = chunkOf(tile + offset);
+      if (neighbour != chunkPosition && chunks.contains(neighbour)) {
+         dirtyChunks.insert(neighbour);
+      }
+   }
+}
+
+void WallChunks::rebuildChunk(Chunk& chunk) const {
+   chunk.wallPaths = std::make_unique<PolyTreeD>();
+   findGridUnion(chunk.walls, *chunk.wallPaths);
+   chunk.bvh = BVH::build(outlineSegments(FlattenPolyPathD(*chunk.wallPaths, false)));
+}
+
+std::vector<Segment> WallChunks::outlineSegments(const PathsD& paths) const {
+   std::vector<Segment> segments;
+   for (const auto& path : paths) {
+      for (size_t i = 0; i < path.size(); i++) {
+         glm::vec2 start(path[i].x, path[i].y);
+         glm::vec2 end(path[(i + 1) % path.size()].x, path[(i + 1) % path.size()].y);
+
+         int steps = static_cast<int>(std::lround(std::max(std::abs(end.x - start.x), std::abs(end.y - start.y))));
+         if (steps == 0 || (start.x != end.x && start.y != end.y)) {
+            segments.push_back(Segment{start, end});
+            continue;
+         }
+
+         // Walk the edge one tile side at a time, keeping the runs that have open space on one side
+         glm::vec2                step   = (end - start) / static_cast<float>(steps);
+         glm::vec2                normal = glm::vec2(step.y, -step.x) * 0.5f;
+         std::optional<glm::vec2> runStart;
+         for (int s = 0; s < steps; s++) {
+            glm::vec2 from     = start + step * static_cast<float>(s);
+            glm::vec2 middle   = from + step * 0.5f;
+            bool      interior = isWall(glm::ivec2(glm::round(middle + normal))) &&
+                            isWall(glm::ivec2(glm::round(middle - normal)));
+            if (!interior && !runStart) {
+               runStart = from;
+            } else if (interior && runStart) {
+               segments.push_back(Segment{*runStart, from});
+               runStart.reset();
+            }
+         }
+         if (runStart) {
+            segments.push_back(Segment{*runStart, end});
+         }
+      }
+   }
+   return segments;
+}
+
+void WallChunks::splice(Chunk& chunk) {
+   auto& merged = assembledWalls.bvh;
+
+   // Ranges that are too small are given up, and new ones with room to grow are added at the end
+   if (chunk.bvh.nodes.size() > chunk.nodes.capacity) {
+      chunk.nodes = Range{merged.nodes.size(), chunk.bvh.nodes.size() * 3 / 2};
+      merged.nodes.resize(chunk.nodes.offset + chunk.nodes.capacity);
+   }
+   if (chunk.bvh.segments.size() > chunk.segments.capacity) {
+      clearSegments(chunk.segments);
+      chunk.segments = Range{merged.segments.size(), chunk.bvh.segments.size() * 3 / 2};
+      merged.segments.resize(chunk.segments.offset + chunk.segments.capacity, EMPTY_SEGMENT);
+   }
+
+   // What the chunk doesn't use is left as empty segments, which no node points to and the visibility sweep skips
+   auto rangeStart = merged.segments.begin() + static_cast<ptrdiff_t>(chunk.segments.offset);
+   std::fill(rangeStart + static_cast<ptrdiff_t>(chunk.bvh.segments.size()),
+             rangeStart + static_cast<ptrdiff_t>(chunk.segments.capacity), EMPTY_SEGMENT);
+   chunk.root.reset();
+   if (!chunk.bvh.nodes.empty()) {
+      chunk.root = merged.place(chunk.bvh, chunk.nodes.offset, chunk.segments.offset);
+   }
+}
+
+void WallChunks::clearSegments(const Range& range) {
+   auto rangeStart = assembledWalls.bvh.segments.begin() + static_cast<ptrdiff_t>(range.offset);
+   std::fill(rangeStart, rangeStart + static_cast<ptrdiff_t>(range.capacity), EMPTY_SEGMENT);
+}
+
+void WallChunks::release(Chunk& chunk) {
+   clearSegments(chunk.segments);
+   chunk.nodes    = {};
+   chunk.segments = {};
+   chunk.root.reset();
+}
+
+void WallChunks::compact() {
+   assembledWalls.bvh.nodes.clear();
+   assembledWalls.bvh.segments.clear();
+   for (auto& [chunkPosition, chunk] : chunks) {
+      chunk.nodes    = {};
+      chunk.segments = {};
+      splice(chunk);
+   }
+}
+
+void WallChunks::updateOutlines() {
+   auto& flattened = assembledWalls.flattened;
+
+   // Take apart the outlines passing a corner of a changed tile, their sides are traced again below. Every side that
+   // can have appeared or disappeared is on the border of a changed tile, and the way the others join up only depends
+   // on the tiles around the corners they meet at, so the remaining outlines stay as they are.
+   std::unordered_map<glm::ivec4, int> untraced;
+   auto                                takeApart = [&](size_t loop) {
+      const auto& corners = loops[loop];
+      for (size_t i = 0; i < corners.size(); i++) {
+         glm::ivec4 side(corners[i], corners[(i + 1) % corners.size()]);
+         sideLoops.erase(side);
+         untraced[side] = 1;
+      }
+      loops[loop].clear();
+      flattened[loop].clear();
+      freeLoops.push_back(loop);
+   };
+   const glm::ivec2 directions[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+   const glm::ivec2 diagonals[]  = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+   for (auto tile : changedTiles) {
+      for (auto diagonal : diagonals) {
+         glm::ivec2 corner = tile * 2 + diagonal;
+         for (auto direction : directions) {
+            glm::ivec2 other = corner + direction * 2;
+            for (glm::ivec4 side : {glm::ivec4(corner, other), glm::ivec4(other, corner)}) {
+               auto found = sideLoops.find(side);
+               if (found != sideLoops.end()) {
+                  takeApart(found->second);
+               }
+            }
+         }
+      }
+   }
+
+   for (auto tile : changedTiles) {
+      for (auto direction : directions) {
+         for (auto [wall, facing] : {std::pair(tile, direction), std::pair(tile + direction, -direction)}) {
+            if (isWall(wall) && !isWall(wall + facing)) {
+               untraced[tileSide(wall, facing)] = 1;
+            } else {
+               untraced.erase(tileSide(wall, facing));
+            }
+         }
+      }
+   }
+   changedTiles.clear();
+
+   for (auto& corners : TraceGridCorners(untraced)) {
+      size_t loop = loops.size();
+      if (!freeLoops.empty()) {
+         loop = freeLoops.back();
+         freeLoops.pop_back();
+      } else {
+         loops.emplace_back();
+         flattened.emplace_back();
+      }
+      for (size_t i = 0; i < corners.size(); i++) {
+         sideLoops[glm::ivec4(corners[i], corners[(i + 1) % corners.size()])] = loop;
+      }
+      flattened[loop] = SimplifyGridLoop(corners);
+      loops[loop]     = std::move(corners);
+   }
+}
+
+const SceneGeometry::WallResult& WallChunks::assemble() {
+   updateOutlines();
+
+   // The top level is rebuilt over all chunk roots at the end
+   auto& merged = assembledWalls.bvh;
+   if (flatBuild) {
+      // The chunks aren't in the merged arrays after a flat build, they all have to be placed again
+      compact();
+      flatBuild = false;
+   } else {
+      merged.nodes.resize(merged.nodes.size() - topLevelNodes);
+   }
+
+   for (auto chunkPosition : dirtyChunks) {
+      auto it = chunks.find(chunkPosition);
+      if (it == chunks.end()) {
+         continue;
+      }
+      if (it->second.walls.empty()) {
+         release(it->second);
+         chunks.erase(it);
+      } else {
+         rebuildChunk(it->second);
+         splice(it->second);
+      }
+   }
+   dirtyChunks.clear();
+
+   size_t usedNodes    = 0;
+   size_t usedSegments = 0;
+   for (const auto& [chunkPosition, chunk] : chunks) {
+      usedNodes += chunk.bvh.nodes.size();
+      usedSegments += chunk.bvh.segments.size();
+   }
+   // Users check for an empty BVH rather than one without segments, which compacting leaves behind
+   if (usedNodes == 0 || merged.nodes.size() > 2 * usedNodes + 256 || merged.segments.size() > 2 * usedSegments + 256) {
+      compact();
+   }
+
+   std::vector<std::pair<size_t, glm::vec4>> roots;
+   uint32_t                                  rootDepth = 0;
+   assembledWalls.wallPaths.clear();
+   for (const auto& [chunkPosition, chunk] : chunks) {
+      assembledWalls.wallPaths.push_back(chunk.wallPaths.get());
+      if (chunk.root) {
+         roots.push_back(*chunk.root);
+         rootDepth = std::max(rootDepth, chunk.bvh.depth);
+      }
+   }
+   size_t chunkNodes = merged.nodes.size();
+   merged.depth      = 0;
+   if (!roots.empty() && !merged.append_top_level(std::move(roots), rootDepth)) {
+      // Too many chunks for a top level that fits in the traversal stack, so the walls get one BVH of their own until
+      // the next change
+      std::vector<Segment> segments;
+      for (const auto& [chunkPosition, chunk] : chunks) {
+         segments.insert(segments.end(), chunk.bvh.segments.begin(), chunk.bvh.segments.end());
+      }
+      merged    = BVH::build(std::move(segments));
+      flatBuild = true;
+   }
+   topLevelNodes = flatBuild ? 0 : merged.nodes.size() - chunkNodes;
+   assembled     = true;
+   return assembledWalls;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#ifndef GLM_ENABLE_EXPERIMENTAL
+#define GLM_ENABLE_EXPERIMENTAL
+#endif
+#include <glm/gtx/hash.hpp>
+#include "clipper2/clipper.h"
+#include "BVH.h"
+#include "SceneGeometry.h"
+
+// Wall tiles split into fixed size chunks. Every chunk keeps its own union, segments and BVH, and the assembled
+// WallResult is kept between calls: a changed wall rebuilds the chunk(s) it touches, splices them into the merged BVH
+// arrays, retraces the outlines passing by it and rebuilds the small top level over the chunk roots.
+class WallChunks {
+public:
+   static constexpr int CHUNK_SIZE = 16;
+
+   void clear();
+   void setWall(glm::ivec2 tile, bool wall);
+   bool isWall(glm::ivec2 tile) const { return walls.contains(tile); }
+
+   // Whether any chunk has changed since the last assemble()
+   bool dirty() const { return !dirtyChunks.empty() || !assembled; }
+
+   // Brings the assembled walls up to date with the changes since the last call
+   const SceneGeometry::WallResult& assemble();
+
+   // The walls as of the last assemble()
+   const SceneGeometry::WallResult& result() const { return assembledWalls; }
+
+private:
+   // Part of the merged node or segment array owned by a chunk
+   struct Range {
+      size_t offset   = 0;
+      size_t capacity = 0;
+   };
+
+   struct Chunk {
+      std::vector<glm::ivec2>                     walls;
+      std::unique_ptr<Clipper2Lib::PolyTreeD>     wallPaths;
+      BVH                                         bvh;
+      Range                                       nodes;
+      Range                                       segments;
+      std::optional<std::pair<size_t, glm::vec4>> root; // In the merged BVH, none if the chunk has no segments
+   };
+
+   static glm::ivec2 chunkOf(glm::ivec2 tile);
+
+   void rebuildChunk(Chunk& chunk) const;
+
+   // Segments of the chunk outline that separate a wall from open space, i.e. without the edges along the chunk border
+   // that only exist because a neighbouring chunk continues the wall
+   std::vector<Segment> outlineSegments(const Clipper2Lib::PathsD& paths) const;
+
+   // Copies the chunk's BVH into its ranges of the merged arrays, moving them to the end if they are too small
+   void splice(Chunk& chunk);
+   void release(Chunk& chunk);
+   void clearSegments(const Range& range);
+
+   // Copies every chunk into fresh merged arrays, for when most of them is left unused
+   void compact();
+
+   // Retraces the outlines that pass by the changed tiles, keeping all the others
+   void updateOutlines();
+
+   std::unordered_set<glm::ivec2>        walls;
+   std::unordered_map<glm::ivec2, Chunk> chunks;
+   std::unordered_set<glm::ivec2>        dirtyChunks;
+   std::unordered_set<glm::ivec2>        changedTiles; // Since the last assemble()
+   bool                                  assembled = false;
+
+   SceneGeometry::WallResult assembledWalls;
+   size_t                    topLevelNodes = 0;     // At the end of the merged nodes
+   bool                      flatBuild     = false; // The merged BVH was built from scratch, without the chunk parts
+
+   // Every tile side between a wall and open space (counter-clockwise around the wall, in doubled coordinates like
+   // TraceGridLoops) mapped to the outline it is part of. Outlines are indices into loops and
+   // assembledWalls.flattened, whose entries are left empty when the outline is gone and reused later.
+   std::unordered_map<glm::ivec4, size_t> sideLoops;
+   std::vector<std::vector<glm::ivec2>>   loops;
+   std::vector<size_t>                    freeLoops;
+};
@@ -7,7 +7,8 @@
 #include <cstring> // For std::memcpy
 #include <memory>  // For std::shared_ptr and std::weak_ptr
 #include "webgpu-utils.h"
-#include "DeadBuffers.h"
+#include "BufferPool.h"
+#include "StagedWrites.h"
 
 #include "Id.h"
 #include "../Application.h"
@@ -42,7 +43,7 @@ struct KeyHash {
 // -----------------------------------------
 
 template <typename T, bool Uniform = false>
-class Buffer : public std::enable_shared_from_this<Buffer<T, Uniform>> {
+class Buffer : public std::enable_shared_from_this<Buffer<T, Uniform>>, public StagedWrites::Target {
 public:
    // Friend declaration to allow BufferView access to private members
    friend class BufferView<T, Uniform>;
@@ -57,23 +58,23 @@ public:
       , name(name)
       , device_(Application::get().getDevice())
       , queue_(Application::get().getQueue())
-      , usage_(usage) {
-      count_    = data.size();
-      capacity_ = count_;
-
-      // Create buffer descriptor
-      wgpu::BufferDescriptor bufferDesc = {};
-      bufferDesc.usage                  = usage_;
-      bufferDesc.mappedAtCreation       = false;
-      bufferDesc.size                   = capacityBytes();
-      bufferDesc.label                  = name.c_str();
-
-      // Create the buffer
-      buffer_ = device_.createBuffer(bufferDesc);
+      , usage_(usage | wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::CopySrc) {
+      // Every buffer is written through the queue and copied into a larger one when it expands, and all the buffers
+      // it goes through share one usage so they come from (and go back to) the same pool
+      count_ = data.size();
+
+      // Take a buffer from the pool, the whole size class is usable
+      size_t size = BufferPool::sizeClass(std::max(count_ * elementStride(), elementStride()));
+      buffer_     = BufferPool::acquire(device_, usage_, size, name.c_str());
       if (!buffer_) {
          std::cerr << "Failed to create buffer." << std::endl;
          return;
       }
+      capacity_ = size / elementStride();
+
+      if constexpr (Uniform) {
+         staging_.resize(capacityBytes());
+      }
 
       // Upload data to the buffer
       upload(data);
@@ -81,8 +82,13 @@ public:
 
    // Destructor: Releases the buffer resource
    ~Buffer() {
+      if (staged) {
+         // Draws recorded this frame may still read it
+         writeStaged();
+         StagedWrites::unstage(this);
+      }
       if (buffer_) {
-         DeadBuffers::buffers.push_back(buffer_);
+         BufferPool::release(buffer_);
       }
    }
 
@@ -96,7 +102,8 @@ public:
    // Method to upload data to the buffer
    void upload(const std::vector<T>& data) {
       if (data.size() > capacity_) {
-         expandBuffer(data.size() * elementStride());
+         // Everything is overwritten below, so the old contents aren't copied over
+         expandBuffer(data.size() * elementStride(), false);
       }
 
       count_ = data.size();
@@ -108,8 +115,8 @@ public:
             // Copy each element into the padded buffer at the correct offset
             std::memcpy(&paddedData[i * elementStride()], &data[i], sizeof(T));
          }
-         // Upload the padded data to the GPU buffer
-         queue_.writeBuffer(buffer_, 0, paddedData.data(), capacityBytes());
+         // Stage the padded data, it's written with the rest of the frame's uniform writes
+         stage(0, paddedData.data(), capacityBytes());
       } else {
          // Calculate the padded size to ensure it's a multiple of 4 bytes
          size_t dataSize   = data.size() * sizeof(T);
@@ -122,7 +129,17 @@ public:
          std::memcpy(paddedData.data(), data.data(), dataSize);
 
          // Upload the padded data to the GPU buffer
-         queue_.writeBuffer(buffer_, 0, paddedData.data(), paddedSize);
+         write(0, paddedData.data(), paddedSize);
+      }
+   }
+
+   // Overwrites elements [first, first + count) in place, leaving count() and the capacity as they are
+   void uploadRange(size_t first, const T* data, size_t count) {
+      static_assert(!Uniform, "Uniform buffers are written through their staged copy");
+      static_assert(sizeof(T) % 4 == 0, "Buffer writes have to be a multiple of 4 bytes");
+      assert(first + count <= capacity_);
+      if (count > 0) {
+         write(first * sizeof(T), data, count * sizeof(T));
       }
    }
 
@@ -189,59 +206,82 @@ public:
 
    int32_t summed_id() const { return id * 100000 + generation; }
 
+   void writeStaged() override {
+      if (dirtyBegin_ < dirtyEnd_) {
+         write(dirtyBegin_, staging_.data() + dirtyBegin_, dirtyEnd_ - dirtyBegin_);
+      }
+      dirtyBegin_ = SIZE_MAX;
+      dirtyEnd_   = 0;
+   }
+
 private:
    // Method to update data at a specific index
    void updateBuffer(const T& data, size_t index) {
-      queue_.writeBuffer(buffer_, index * elementStride(), &data, sizeof(T));
+      if constexpr (Uniform) {
+         stage(index * elementStride(), &data, sizeof(T));
+      } else {
+         write(index * elementStride(), &data, sizeof(T));
+      }
+   }
+
+   void write(size_t offset, const void* data, size_t size) {
+      queue_.writeBuffer(buffer_, offset, data, size);
+      StagedWrites::writes++;
+   }
+
+   // Copies into the CPU side copy of a uniform buffer and widens the range that goes out with writeStaged()
+   void stage(size_t offset, const void* data, size_t size) {
+      std::memcpy(staging_.data() + offset, data, size);
+      dirtyBegin_ = std::min(dirtyBegin_, offset & ~size_t(3));
+      dirtyEnd_   = std::max(dirtyEnd_, (offset + size + 3) & ~size_t(3));
+      StagedWrites::stage(this);
    }
 
    // Method to resize the buffer
    void expandBuffer() { expandBuffer(capacityBytes() * 2); }
 
-   void expandBuffer(size_t newSize) {
-      std::cout << "Expanding buffer" << std::endl;
+   void expandBuffer(size_t newSize, bool keepContents = true) {
       newSize = std::max(newSize, elementStride()); // Ensure the buffer is at least the length of one element
 
-      // Create a new buffer with the new size
-      wgpu::BufferDescriptor newBufferDesc = {};
-      newBufferDesc.size                   = newSize;
-      newBufferDesc.usage                  = usage_ | wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::CopySrc;
-      newBufferDesc.mappedAtCreation       = false;
-      std::string label                    = name + " (gen " + std::to_string(generation) + ")";
-      newBufferDesc.label                  = label.c_str();
-
-      wgpu::Buffer newBuffer = device_.createBuffer(newBufferDesc);
+      // Get a buffer of the new size from the pool
+      newSize                = BufferPool::sizeClass(newSize);
+      std::string  label     = name + " (gen " + std::to_string(generation) + ")";
+      wgpu::Buffer newBuffer = BufferPool::acquire(device_, usage_, newSize, label.c_str());
       if (!newBuffer) {
          std::cerr << "Failed to create resized buffer." << std::endl;
          return;
       }
 
-      // Create a command encoder
-      // TODO: Should probably not be recreating the encoder every time we want to resize the buffer
-      // Instead, maybe we should store the encoder in Application and reuse it within a frame, or accumulate a queue
-      // of things to add and add them all once we call `flush`
-      // (which would also minimize wasted copies when resizing multiple times within a frame)
-      wgpu::CommandEncoder* encoder = Application::get().encoder;
-      if (!encoder) {
-         std::cerr << "No encoder found when trying to resize buffer " << name << std::endl;
-         assert(false);
-      }
+      if constexpr (Uniform) {
+         // The staged copy holds the whole buffer, so it's written out again instead of copied on the GPU
+         staging_.resize(newSize, 0);
+         dirtyBegin_ = 0;
+         dirtyEnd_   = newSize;
+         StagedWrites::stage(this);
+      } else if (keepContents) {
+         // Create a command encoder
+         // TODO: Should probably not be recreating the encoder every time we want to resize the buffer
+         // Instead, maybe we should store the encoder in Application and reuse it within a frame, or accumulate a
+         // queue of things to add and add them all once we call `flush`
+         // (which would also minimize wasted copies when resizing multiple times within a frame)
+         wgpu::CommandEncoder* encoder = Application::get().encoder;
+         if (!encoder) {
+            std::cerr << "No encoder found when trying to resize buffer " << name << std::endl;
+            assert(false);
+         }
 
-      // Copy existing data from old buffer to new buffer
-      auto bytes_to_copy = sizeBytes();
-      std::cout << "Copying " << bytes_to_copy << " bytes from old buffer to new buffer" << std::endl;
-      encoder->copyBufferToBuffer(buffer_, 0, newBuffer, 0, bytes_to_copy);
+         // Copy existing data from old buffer to new buffer
+         encoder->copyBufferToBuffer(buffer_, 0, newBuffer, 0, sizeBytes());
+      }
 
       generation++;
 
-      // Queue the old buffer for destruction
-      DeadBuffers::buffers.push_back(buffer_);
+      // Return the old buffer to the pool, it's reused once this frame has been submitted
+      BufferPool::release(buffer_);
       buffer_ = newBuffer;
 
       // Update buffer capacity now that it's been resized
       capacity_ = newSize / elementStride();
-
-      std::cout << "Buffer " << name << " resized - new capacity: " << capacityBytes() << " bytes" << std::endl;
    }
 
    // Method to free an index (called by BufferView destructor)
@@ -264,9 +304,15 @@ private:
    // Allocation management
    size_t              capacity_ = 0; // Tracks the number of allocated elements
    std::vector<size_t> freeIndices_;  // Tracks freed indices for reuse
+
+   // CPU side copy of uniform buffers and the byte range that changed since the last writeStaged()
+   std::vector<uint8_t> staging_;
+   size_t               dirtyBegin_ = SIZE_MAX;
+   size_t               dirtyEnd_   = 0;
 };
 
-using IndexBuffer = Buffer<uint16_t, false>;
+using IndexBuffer   = Buffer<uint16_t, false>;
+using IndexBuffer32 = Buffer<uint32_t, false>; // For meshes with more than 65535 vertices
 
 template <typename T>
 using UniformBuffer = Buffer<T, true>;
@@ -0,0 +1,73 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <bit>
+
+std::unordered_map<uint64_t, std::vector<BufferPool::FreeBuffer>> BufferPool::freeBuffers     = {};
+std::vector<wgpu::Buffer>                                         BufferPool::pending         = {};
+uint64_t                                                          BufferPool::frame           = 0;
+size_t                                                            BufferPool::hits            = 0;
+size_t                                                            BufferPool::misses          = 0;
+size_t                                                            BufferPool::lastFrameHits   = 0;
+size_t                                                            BufferPool::lastFrameMisses = 0;
+
+size_t BufferPool::sizeClass(size_t size) {
+   return std::bit_ceil(std::max(size, MIN_SIZE));
+}
+
+wgpu::Buffer BufferPool::acquire(wgpu::Device& device, wgpu::BufferUsage usage, size_t size, const char* label) {
+   size = sizeClass(size);
+
+   auto it = freeBuffers.find(key(usage, size));
+   if (it != freeBuffers.end() && !it->second.empty()) {
+      // The most recently released buffer, so the older ones are the ones left to be evicted
+      wgpu::Buffer buffer = it->second.back().buffer;
+      it->second.pop_back();
+      buffer.setLabel(label);
+      hits++;
+      return buffer;
+   }
+
+   wgpu::BufferDescriptor bufferDesc = {};
+   bufferDesc.usage                  = usage;
+   bufferDesc.mappedAtCreation       = false;
+   bufferDesc.size                   = size;
+   bufferDesc.label                  = label;
+   misses++;
+   return device.createBuffer(bufferDesc);
+}
+
+void BufferPool::release(wgpu::Buffer buffer) {
+   pending.push_back(buffer);
+}
+
+void BufferPool::endFrame() {
+   for (auto& buffer : pending) {
+      freeBuffers[key(buffer.getUsage(), buffer.getSize())].push_back(FreeBuffer{buffer, frame});
+   }
+   pending.clear();
+
+   for (auto& [bucket, buffers] : freeBuffers) {
+      std::erase_if(buffers, [](FreeBuffer& entry) {
+         if (frame - entry.releasedFrame < EVICT_AFTER_FRAMES) {
+            return false;
+         }
+         entry.buffer.destroy();
+         entry.buffer.release();
+         return true;
+      });
+   }
+
+   lastFrameHits   = hits;
+   lastFrameMisses = misses;
+   hits            = 0;
+   misses          = 0;
+   frame++;
+}
+
+size_t BufferPool::freeCount() {
+   size_t count = 0;
+   for (auto& [bucket, buffers] : freeBuffers) {
+      count += buffers.size();
+   }
+   return count;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+// GPU buffers sorted by usage and power of two size. Buffers that are released (a Buffer was destroyed or outgrew its
+// wgpu::Buffer) are handed out again instead of destroyed, so buffers that come and go every frame stop allocating.
+class BufferPool {
+public:
+   static constexpr size_t MIN_SIZE = 256;
+
+   // Buffers nobody asked for in this many frames are destroyed
+   static constexpr uint64_t EVICT_AFTER_FRAMES = 120;
+
+   // The size a request for `size` bytes is rounded up to
+   static size_t sizeClass(size_t size);
+
+   // A buffer of exactly sizeClass(size) bytes, reused from the pool if one is free
+   static wgpu::Buffer acquire(wgpu::Device& device, wgpu::BufferUsage usage, size_t size, const char* label);
+
+   // Commands recorded this frame may still use the buffer, so it's only handed out again after the frame is submitted
+   static void release(wgpu::Buffer buffer);
+
+   // Makes the buffers released this frame available and evicts the idle ones, called after the frame is submitted
+   static void endFrame();
+
+   // Requests served from the pool / by creating a buffer, in the current / last finished frame
+   static size_t hits;
+   static size_t misses;
+   static size_t lastFrameHits;
+   static size_t lastFrameMisses;
+
+   // Buffers sitting in the pool
+   static size_t freeCount();
+
+private:
+   struct FreeBuffer {
+      wgpu::Buffer buffer;
+      uint64_t     releasedFrame;
+   };
+
+   static uint64_t key(WGPUBufferUsage usage, size_t size) {
+      return (static_cast<uint64_t>(usage) << 48) ^ static_cast<uint64_t>(size);
+   }
+
+   static std::unordered_map<uint64_t, std::vector<FreeBuffer>> freeBuffers;
+   static std::vector<wgpu::Buffer>                             pending; // Released this frame
+   static uint64_t                                              frame;
+};
@@ -1,5 +1,5 @@
 #include "CommandEncoder.h"
-#include "DeadBuffers.h"
+#include "StagedWrites.h"
 #include "Application.h"
 #include <iostream>
 
@@ -19,6 +19,8 @@ CommandEncoder::~CommandEncoder() {
    auto& application = Application::get();
    auto  queue       = application.getQueue();
 
+   // Uniform writes staged during the frame have to land before the commands that read them
+   StagedWrites::flush();
    queue.submit(1, &command);
 
    encoder_.release();
@@ -28,11 +30,3 @@ CommandEncoder::~CommandEncoder() {
 wgpu::CommandEncoder& CommandEncoder::get() {
    return encoder_;
 }
-
-void CommandEncoder::DestroyDeadBuffers() {
-   for (auto& buffer : DeadBuffers::buffers) {
-      buffer.destroy();
-      buffer.release();
-   }
-   DeadBuffers::buffers.clear();
-}
@@ -9,8 +9,6 @@ public:
 
    wgpu::CommandEncoder& get();
 
-   static void DestroyDeadBuffers();
-
 private:
    wgpu::Device         device_;
    wgpu::CommandEncoder encoder_;
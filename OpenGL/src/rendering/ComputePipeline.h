@@ -15,7 +15,7 @@ static int32_t created_render_pipelines = 0;
 template <typename BGLs>
 class ComputePipeline {
 public:
-   ComputePipeline(std::filesystem::path shaderPath)
+   ComputePipeline(std::filesystem::path shaderPath, const char* entryPoint = "compute_main")
       : id(Id::get())
       , device(Application::get().getDevice())
       , bindGroupLayouts(BGLs::CreateLayouts(device)) {
@@ -32,7 +32,7 @@ public:
       wgpu::ComputePipelineDescriptor computePipelineDesc = wgpu::Default;
       computePipelineDesc.compute.constantCount           = 0;
       computePipelineDesc.compute.constants               = nullptr;
-      computePipelineDesc.compute.entryPoint              = "compute_main";
+      computePipelineDesc.compute.entryPoint              = entryPoint;
       computePipelineDesc.compute.module                  = shader.GetShaderModule();
       computePipelineDesc.layout                          = layout;
 
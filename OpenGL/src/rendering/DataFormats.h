@@ -4,6 +4,7 @@
 #include "VertexBufferLayout.h"
 #include "BindGroupLayout.h"
 #include "../geometry/BVH.h"
+#include "../geometry/ParticleSimulation.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/gtx/hash.hpp"
@@ -55,23 +56,33 @@ struct hash<SquareObjectVertex> {
 };
 } // namespace std
 
-struct SquareObjectVertexUniform {
-   glm::mat4 u_MVP;
+// One sprite of a SpriteBatch, tightly packed to match SpriteInstance::Layout
+struct SpriteInstance {
+   glm::vec2 axisX; // First two columns and translation of the world transform, the quad is a unit square
+   glm::vec2 axisY;
+   glm::vec2 translation;
+   glm::vec4 tint; // Mixed over the texture by its alpha
+   float     opacity;
+   glm::vec4 textureRect; // UV offset and size in the texture atlas
+
+   SpriteInstance() = default;
+   SpriteInstance(const glm::mat4& transform, glm::vec4 tint, float opacity, glm::vec4 textureRect)
+      : axisX(transform[0])
+      , axisY(transform[1])
+      , translation(transform[3])
+      , tint(tint)
+      , opacity(opacity)
+      , textureRect(textureRect) {}
+
+   using Layout = InstanceBufferLayout<glm::vec2, glm::vec2, glm::vec2, glm::vec4, float, glm::vec4>;
 };
 
-struct SquareObjectFragmentUniform {
-   glm::vec4 u_Color;
-   float     u_Opacity; // at byte offset 16
-   float     _pad0[3];
-
-   SquareObjectFragmentUniform(glm::vec4 u_Color, float u_Opacity)
-      : u_Color(u_Color)
-      , u_Opacity(u_Opacity) {}
+struct SpriteUniform {
+   glm::mat4 u_VP;
 };
 
-using SquareObjectLayout = BindGroupLayout<
-   BufferBinding<SquareObjectVertexUniform, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform, true>,
-   BufferBinding<SquareObjectFragmentUniform, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::Uniform, true>,
+using SpriteLayout = BindGroupLayout<
+   BufferBinding<SpriteUniform, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform, false>,
    TextureBinding<wgpu::ShaderStage::Fragment, wgpu::TextureSampleType::Float, wgpu::TextureViewDimension::_2D>,
    SamplerBinding<wgpu::ShaderStage::Fragment, wgpu::SamplerBindingType::NonFiltering>>;
 // ============================================================
@@ -79,32 +90,31 @@ using SquareObjectLayout = BindGroupLayout<
 // Line
 // ============================================================
 
+// One debug line, tightly packed to match LineInstance::Layout
+struct LineInstance {
+   glm::vec2 start;
+   glm::vec2 end;
+   glm::vec4 color;
+
+   using Layout = InstanceBufferLayout<glm::vec2, glm::vec2, glm::vec4>;
+};
+
 // Laid out with
 // https://eliemichel.github.io/WebGPU-AutoLayout/
-struct LineVertexUniform {
-   glm::vec2 u_StartPos; // at byte offset 0
-   glm::vec2 u_EndPos;   // at byte offset 8
-   float     u_Width;    // at byte offset 16
+struct LineUniform {
+   glm::mat4 u_VP;    // at byte offset 0
+   float     u_Width; // at byte offset 64
    float     _pad0[3];
-   glm::mat4 u_MVP; // at byte offset 32
-
-   LineVertexUniform(glm::vec2 u_StartPos, glm::vec2 u_EndPos, float u_Width, glm::mat4 u_MVP)
-      : u_StartPos(u_StartPos)
-      , u_EndPos(u_EndPos)
-      , u_Width(u_Width)
-      , u_MVP(u_MVP) {}
-};
 
-struct LineFragmentUniform {
-   glm::vec4 u_Color;
+   LineUniform(glm::mat4 u_VP, float u_Width)
+      : u_VP(u_VP)
+      , u_Width(u_Width) {}
 };
 
 using LineVertex = glm::vec2;
 
-using LineLayout = BindGroupLayout<
-   BufferBinding<LineVertexUniform, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform, false>,    // vertex
-   BufferBinding<LineFragmentUniform, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::Uniform, false> // fragment
-   >;
+using LineLayout =
+   BindGroupLayout<BufferBinding<LineUniform, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform, false>>;
 // ============================================================
 
 // Fog
@@ -143,6 +153,14 @@ using FogFragmentUniformBinding = BufferBinding<FogFragmentUniform,
                                                 >;
 
 using FogLayout = BindGroupLayout<FogVertexUniformBinding, FogFragmentUniformBinding>;
+
+// Fog with the visibility test done per fragment against the wall BVH (fog_gpu.wgsl)
+using FogSegmentBinding =
+   BufferBinding<Segment, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::ReadOnlyStorage, false>;
+using FogBvhNodeBinding =
+   BufferBinding<BvhNode, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::ReadOnlyStorage, false>;
+using FogShadowLayout =
+   BindGroupLayout<FogVertexUniformBinding, FogFragmentUniformBinding, FogSegmentBinding, FogBvhNodeBinding>;
 using FogVertex = glm::vec2;
 // ============================================================
 
@@ -195,10 +213,39 @@ struct ParticleWorldInfo {
       : deltaTime(deltaTime) {}
 };
 
+// Invocations per workgroup of every kernel in particlesCompute.wgsl
+constexpr uint32_t PARTICLE_WORKGROUP_SIZE = 256;
+
+// Written by the compaction passes. The first five fields are the arguments of drawIndexedIndirect, so the live
+// particles can be drawn without reading the count back.
+struct ParticleCounters {
+   uint32_t indexCount;
+   uint32_t instanceCount;  // Live particles, at the front of the particle buffer
+   uint32_t firstIndex;
+   int32_t  baseVertex;
+   uint32_t firstInstance;
+   uint32_t simulatedCount; // Live particles before the last compaction
+   uint32_t _pad0[2];
+
+   ParticleCounters(uint32_t indexCount, uint32_t liveCount)
+      : indexCount(indexCount)
+      , instanceCount(liveCount)
+      , firstIndex(0)
+      , baseVertex(0)
+      , firstInstance(0)
+      , simulatedCount(liveCount) {}
+};
+
 using ParticleLayout = BindGroupLayout<
    BufferBinding<ParticleVertexUniform, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform, true>>;
 using ParticleComputeLayout =
    BindGroupLayout<BufferBinding<Particle, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage, false>,
                    BufferBinding<ParticleWorldInfo, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform, true>,
                    BufferBinding<Segment, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage, false>,
-                   BufferBinding<BvhNode, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage, false>>;
+                   BufferBinding<BvhNode, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage, false>,
+                   BufferBinding<Particle, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage, false>,
+                   BufferBinding<uint32_t, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage, false>,
+                   BufferBinding<uint32_t, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage, false>,
+                   BufferBinding<ParticleCounters, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage,
+                                 false>,
+                   BufferBinding<ParticleEmitter, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform, true>>;
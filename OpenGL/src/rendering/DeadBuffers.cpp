@@ -1,3 +0,0 @@
-#include "DeadBuffers.h"
-
-std::vector<wgpu::Buffer> DeadBuffers::buffers = {};
@@ -47,15 +47,18 @@ public:
       }
    }
 
-   void setIndexBuffer(const IndexBuffer& buffer) {
+   template <typename Index>
+   void setIndexBuffer(const Buffer<Index>& buffer) {
+      static_assert(std::is_same_v<Index, uint16_t> || std::is_same_v<Index, uint32_t>, "Unsupported index type");
       if (last_set_index_buffer != (int32_t)buffer.summed_id()) {
-         renderPass_.setIndexBuffer(buffer.get(), wgpu::IndexFormat::Uint16, 0, buffer.sizeBytes());
+         auto format = std::is_same_v<Index, uint16_t> ? wgpu::IndexFormat::Uint16 : wgpu::IndexFormat::Uint32;
+         renderPass_.setIndexBuffer(buffer.get(), format, 0, buffer.sizeBytes());
          last_set_index_buffer = buffer.summed_id();
       }
    }
 
-   template <typename Pipeline, typename... Vertices>
-   void DrawInstanced(const Pipeline& pipeline, const IndexBuffer& indexBuffer, BindGroup bindGroup,
+   template <typename Pipeline, typename Index, typename... Vertices>
+   void DrawInstanced(const Pipeline& pipeline, const Buffer<Index>& indexBuffer, BindGroup bindGroup,
                       std::vector<uint32_t> offset, uint32_t instanceCount, Buffer<Vertices>&... bufs) {
       setPipeline(pipeline);
       setBindGroup(0, bindGroup, offset);
@@ -66,14 +69,34 @@ public:
 
       setIndexBuffer(indexBuffer);
       renderPass_.drawIndexed(indexBuffer.count(), instanceCount, 0, 0, 0);
+      drawCalls++;
    }
 
-   template <typename Pipeline, typename Vertex>
-   void Draw(const Pipeline& pipeline, Buffer<Vertex>& pointBuffer, const IndexBuffer& indexBuffer, BindGroup bindGroup,
-             std::vector<uint32_t> offset) {
+   // Same as DrawInstanced, with the draw arguments read from `indirectBuffer` at `indirectOffset` on the GPU
+   template <typename Pipeline, typename Index, typename Args, typename... Vertices>
+   void DrawInstancedIndirect(const Pipeline& pipeline, const Buffer<Index>& indexBuffer, BindGroup bindGroup,
+                              std::vector<uint32_t> offset, const Buffer<Args>& indirectBuffer, uint64_t indirectOffset,
+                              Buffer<Vertices>&... bufs) {
+      setPipeline(pipeline);
+      setBindGroup(0, bindGroup, offset);
+
+      size_t bufferIndex = 0;
+      (setVertexBuffer(bufs, bufferIndex++), ...);
+
+      setIndexBuffer(indexBuffer);
+      renderPass_.drawIndexedIndirect(indirectBuffer.get(), indirectOffset);
+      drawCalls++;
+   }
+
+   template <typename Pipeline, typename Vertex, typename Index>
+   void Draw(const Pipeline& pipeline, Buffer<Vertex>& pointBuffer, const Buffer<Index>& indexBuffer,
+             BindGroup bindGroup, std::vector<uint32_t> offset) {
       DrawInstanced(pipeline, indexBuffer, bindGroup, offset, 1, pointBuffer);
    }
 
+   // Draw calls recorded into this pass so far
+   size_t getDrawCalls() const { return drawCalls; }
+
 private:
    wgpu::RenderPassEncoder renderPass_;
 
@@ -84,4 +107,5 @@ private:
    int32_t               last_set_vertex_buffer       = -1;
    int32_t               last_set_vertex_buffer_index = -1;
    int32_t               last_set_index_buffer        = -1;
+   size_t                drawCalls                    = 0;
 };
@@ -1,4 +1,5 @@
 #include "Renderer.h"
+#include <bit>
 #include "Application.h"
 
 #include "glm/gtc/matrix_transform.hpp"
@@ -7,16 +8,26 @@
 Renderer::Renderer()
    : stars(RenderPipeline<BindGroupLayouts<BindGroupLayout<StarUniformBinding>>,
                           VertexBufferLayouts<VertexBufferLayout<glm::vec2>>>("stars.wgsl"))
-   , squareObject(RenderPipeline<BindGroupLayouts<SquareObjectLayout>,
-                                 VertexBufferLayouts<VertexBufferLayout<glm::vec2, glm::vec2>>>("square_object.wgsl"))
-   , line(
-        RenderPipeline<BindGroupLayouts<LineLayout>, VertexBufferLayouts<VertexBufferLayout<LineVertex>>>("line.wgsl"))
+   , squareObject(
+        RenderPipeline<BindGroupLayouts<SpriteLayout>,
+                       VertexBufferLayouts<VertexBufferLayout<glm::vec2, glm::vec2>, SpriteInstance::Layout>>(
+           "square_object.wgsl"))
+   , line(RenderPipeline<BindGroupLayouts<LineLayout>,
+                         VertexBufferLayouts<VertexBufferLayout<LineVertex>, LineInstance::Layout>>("line.wgsl"))
    , fog(RenderPipeline<BindGroupLayouts<FogLayout>, VertexBufferLayouts<VertexBufferLayout<FogVertex>>>("fog.wgsl"))
+   , fogShadow(RenderPipeline<BindGroupLayouts<FogShadowLayout>, VertexBufferLayouts<VertexBufferLayout<FogVertex>>>(
+        "fog_gpu.wgsl"))
    , particles(RenderPipeline<BindGroupLayouts<ParticleLayout>,
                               VertexBufferLayouts<VertexBufferLayout<glm::vec2>,
                                                   InstanceBufferLayout<glm::vec2, glm::vec2, glm::vec4, float, float>>>(
         "particles.wgsl"))
    , particlesCompute(ComputePipeline<BindGroupLayouts<ParticleComputeLayout>>("particlesCompute.wgsl"))
+   , particlesEmit(ComputePipeline<BindGroupLayouts<ParticleComputeLayout>>("particlesCompute.wgsl", "emit"))
+   , particlesScanBlocks(
+        ComputePipeline<BindGroupLayouts<ParticleComputeLayout>>("particlesCompute.wgsl", "scan_blocks"))
+   , particlesScanBlockSums(
+        ComputePipeline<BindGroupLayouts<ParticleComputeLayout>>("particlesCompute.wgsl", "scan_block_sums"))
+   , particlesScatter(ComputePipeline<BindGroupLayouts<ParticleComputeLayout>>("particlesCompute.wgsl", "scatter"))
    , device(Application::get().getDevice())
    , linePoints(
         std::vector<LineVertex>{
@@ -31,7 +42,9 @@ Renderer::Renderer()
          0, 1, 2, // Triangle #0 connects points #0, #1 and #2
          2, 3, 0  // Triangle #1 connects points #0, #2 and #3
       },
-      wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index)) {}
+      wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index))
+   , lineUniform({LineUniform(glm::mat4(1.0f), 0.1f)},
+                 wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Uniform)) {}
 
 glm::mat4 CalculateModel(const glm::vec2& objectPosition, float objectRotationDegrees, float objectScale) {
    glm::mat4 model           = glm::translate(glm::mat4(1.0f), glm::vec3(objectPosition, 0.0f));
@@ -68,24 +81,16 @@ glm::mat4 CalculateMVP(const glm::vec2& objectPosition, float objectRotationDegr
    return projection * view * model;
 }
 
-void Renderer::DrawLine(Line line, RenderPass& renderPass) {
-   auto                             mvp = CalculateMVP({0, 0}, 0, 1);
-   LineVertexUniform                vertexUniform(line.start, line.end, 0.1f, mvp);
-   LineFragmentUniform              fragmentUniform{line.color};
-   UniformBuffer<LineVertexUniform> vertexUniformBuffer(
-      {vertexUniform}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Uniform));
-   UniformBuffer<LineFragmentUniform> fragmentUniformBuffer(
-      {fragmentUniform}, wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Uniform));
-
-   BindGroup bindGroup = LineLayout::ToBindGroup(device, std::forward_as_tuple(vertexUniformBuffer, 0),
-                                                 std::forward_as_tuple(fragmentUniformBuffer, 0));
+glm::vec4 CalculateViewBounds() {
+   glm::ivec2 windowSize  = Application::get().windowSize();
+   float      aspectRatio = static_cast<float>(windowSize.x) / static_cast<float>(windowSize.y);
 
-   renderPass.Draw(this->line, linePoints, lineIndices, bindGroup, {});
+   glm::vec2 halfSize = glm::vec2(Camera::scale * aspectRatio, Camera::scale) / 2.0f;
+   return glm::vec4(Camera::position - halfSize, Camera::position + halfSize);
 }
 
-
-std::vector<Line>& GetDebugLines() {
-   static std::vector<Line> debugLines; // Initialized within the function
+std::vector<LineInstance>& GetDebugLines() {
+   static std::vector<LineInstance> debugLines; // Initialized within the function
    return debugLines;
 }
 
@@ -99,10 +104,25 @@ void Renderer::DebugLine(glm::vec2 start, glm::vec2 end, glm::vec4 color) {
 
 
 void Renderer::DrawDebug(RenderPass& renderPass) {
-   for (const auto& line : GetDebugLines()) {
-      this->DrawLine(line, renderPass);
+   auto& lines    = GetDebugLines();
+   linesThisFrame = lines.size();
+   if (lines.empty()) {
+      return;
    }
-   GetDebugLines().clear();
+
+   if (!lineInstances || lineInstances->capacityBytes() < lines.size() * sizeof(LineInstance)) {
+      // Replaced instead of expanded, expanding would copy the old contents on the frame's encoder mid render pass
+      lineInstances = std::make_shared<Buffer<LineInstance>>(
+         std::vector<LineInstance>(std::bit_ceil(lines.size())),
+         wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex), "Debug Lines");
+   }
+   lineInstances->upload(lines);
+   lineUniform.upload({LineUniform(CalculateProjection() * CalculateView(), 0.1f)});
+
+   BindGroup bindGroup = LineLayout::ToBindGroup(device, std::forward_as_tuple(lineUniform, 0));
+   renderPass.DrawInstanced(line, lineIndices, bindGroup, {}, static_cast<uint32_t>(lines.size()), linePoints,
+                            *lineInstances);
+   lines.clear();
 }
 
 
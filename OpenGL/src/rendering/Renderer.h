@@ -9,17 +9,11 @@
 #include "TextureSampler.h"
 #include "CommandEncoder.h"
 #include "Buffer.h"
+#include "SpriteBatch.h"
 
 #include "imgui.h"
 
 
-class Line {
-public:
-   glm::vec2 start;
-   glm::vec2 end;
-   glm::vec4 color;
-};
-
 class Renderer {
 public:
    Renderer();
@@ -27,35 +21,48 @@ public:
    RenderPipeline<BindGroupLayouts<BindGroupLayout<StarUniformBinding>>,
                   VertexBufferLayouts<VertexBufferLayout<glm::vec2>>>
       stars;
-   RenderPipeline<BindGroupLayouts<SquareObjectLayout>, VertexBufferLayouts<VertexBufferLayout<glm::vec2, glm::vec2>>>
+   RenderPipeline<BindGroupLayouts<SpriteLayout>,
+                  VertexBufferLayouts<VertexBufferLayout<glm::vec2, glm::vec2>, SpriteInstance::Layout>>
                                                                                                      squareObject;
-   RenderPipeline<BindGroupLayouts<LineLayout>, VertexBufferLayouts<VertexBufferLayout<LineVertex>>> line;
-   RenderPipeline<BindGroupLayouts<FogLayout>, VertexBufferLayouts<VertexBufferLayout<FogVertex>>>   fog;
+   RenderPipeline<BindGroupLayouts<LineLayout>,
+                  VertexBufferLayouts<VertexBufferLayout<LineVertex>, LineInstance::Layout>>
+                                                                                                     line;
+   RenderPipeline<BindGroupLayouts<FogLayout>, VertexBufferLayouts<VertexBufferLayout<FogVertex>>> fog;
+   RenderPipeline<BindGroupLayouts<FogShadowLayout>, VertexBufferLayouts<VertexBufferLayout<FogVertex>>> fogShadow;
    RenderPipeline<BindGroupLayouts<ParticleLayout>,
                   VertexBufferLayouts<VertexBufferLayout<glm::vec2>,
                                       InstanceBufferLayout<glm::vec2, glm::vec2, glm::vec4, float, float>>>
                                                             particles;
    ComputePipeline<BindGroupLayouts<ParticleComputeLayout>> particlesCompute;
+   ComputePipeline<BindGroupLayouts<ParticleComputeLayout>> particlesEmit;
+   ComputePipeline<BindGroupLayouts<ParticleComputeLayout>> particlesScanBlocks;
+   ComputePipeline<BindGroupLayouts<ParticleComputeLayout>> particlesScanBlockSums;
+   ComputePipeline<BindGroupLayouts<ParticleComputeLayout>> particlesScatter;
 
    TextureSampler sampler;
 
    wgpu::Device device;
 
+   // SquareObjects queue their sprites here, World::RenderObjects flushes them once per draw priority layer
+   SpriteBatch sprites;
+
    static glm::vec2 MousePos();
    static glm::vec2 ScreenToWorldPosition(const glm::vec2& screenPos);
 
-   // Debug assistance
+   // Debug assistance, the lines queued during a frame are drawn together by DrawDebug
    static void DebugLine(glm::vec2 start, glm::vec2 end, glm::vec3 color);
    static void DebugLine(glm::vec2 start, glm::vec2 end, glm::vec4 color);
    void        DrawDebug(RenderPass& renderPass);
+   size_t      getLinesThisFrame() const { return linesThisFrame; }
 
-   void FinishFrame() { CommandEncoder::DestroyDeadBuffers(); }
+   void FinishFrame() { BufferPool::endFrame(); }
 
 private:
-   void DrawLine(Line line, RenderPass& renderPass);
-
-   Buffer<LineVertex> linePoints;
-   IndexBuffer        lineIndices;
+   Buffer<LineVertex>                    linePoints;
+   IndexBuffer                           lineIndices;
+   UniformBuffer<LineUniform>            lineUniform;
+   std::shared_ptr<Buffer<LineInstance>> lineInstances; // Replaced when a frame has more lines than fit
+   size_t                                linesThisFrame = 0;
 };
 
 
@@ -63,3 +70,5 @@ glm::mat4 CalculateModel(const glm::vec2& objectPosition, float objectRotationDe
 glm::mat4 CalculateView();
 glm::mat4 CalculateProjection();
 glm::mat4 CalculateMVP(const glm::vec2& objectPosition, float objectRotationDegrees, float objectScale);
+// World space rectangle the camera sees, with the minimum in xy and the maximum in zw
+glm::vec4 CalculateViewBounds();
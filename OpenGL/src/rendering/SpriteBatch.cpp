@@ -0,0 +1,60 @@
+#include "SpriteBatch.h"
+
+#include <bit>
+#include "Renderer.h"
+#include "RenderPass.h"
+#include "TextureAtlas.h"
+
+SpriteBatch::SpriteBatch()
+   : pointBuffer(Buffer<SquareObjectVertex>::create(
+        {
+           SquareObjectVertex{glm::vec2(-0.5f, -0.5f), glm::vec2(0.0f, 0.0f)}, // 0
+           SquareObjectVertex{glm::vec2(0.5f, -0.5f), glm::vec2(1.0f, 0.0f)},  // 1
+           SquareObjectVertex{glm::vec2(0.5f, 0.5f), glm::vec2(1.0f, 1.0f)},   // 2
+           SquareObjectVertex{glm::vec2(-0.5f, 0.5f), glm::vec2(0.0f, 1.0f)},  // 3
+        },
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex)))
+   , indexBuffer(IndexBuffer::create(
+        {
+           0, 1, 2, // Triangle #0 connects points #0, #1 and #2
+           0, 2, 3  // Triangle #1 connects points #0, #2 and #3
+        },
+        wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Index)))
+   , uniform({SpriteUniform{glm::mat4(1.0f)}},
+             wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Uniform)) {}
+
+void SpriteBatch::beginFrame() {
+   instances.clear();
+   flushesThisFrame = 0;
+   spritesThisFrame = 0;
+   uniform.upload({SpriteUniform{CalculateProjection() * CalculateView()}});
+}
+
+void SpriteBatch::flush(Renderer& renderer, RenderPass& renderPass) {
+   if (instances.empty()) {
+      return;
+   }
+
+   if (flushesThisFrame == layerBuffers.size()) {
+      layerBuffers.push_back(nullptr);
+   }
+   auto& buffer = layerBuffers[flushesThisFrame++];
+   if (!buffer || buffer->capacityBytes() < instances.size() * sizeof(SpriteInstance)) {
+      // Replaced instead of expanded, expanding would copy the old contents on the frame's encoder mid render pass
+      buffer = std::make_shared<Buffer<SpriteInstance>>(
+         std::vector<SpriteInstance>(std::bit_ceil(instances.size())),
+         wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::Vertex), "Sprite Instances");
+   }
+   buffer->upload(instances);
+   draw(renderer, renderPass, *buffer);
+
+   spritesThisFrame += instances.size();
+   instances.clear();
+}
+
+void SpriteBatch::draw(Renderer& renderer, RenderPass& renderPass, Buffer<SpriteInstance>& instanceBuffer) {
+   BindGroup bindGroup = SpriteLayout::ToBindGroup(renderer.device, std::forward_as_tuple(uniform, 0),
+                                                   TextureAtlas::get().getTexture(), renderer.sampler);
+   renderPass.DrawInstanced(renderer.squareObject, *indexBuffer, bindGroup, {},
+                            static_cast<uint32_t>(instanceBuffer.count()), *pointBuffer, instanceBuffer);
+}
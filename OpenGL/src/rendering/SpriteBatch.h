@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Buffer.h"
+#include "DataFormats.h"
+
+class Renderer;
+class RenderPass;
+
+// Collects the sprites of one draw priority layer and draws them with a single instanced draw. All sprites come from
+// the TextureAtlas, so they share one bind group.
+class SpriteBatch {
+public:
+   SpriteBatch();
+
+   // Resets the per frame buffers, has to be called before the first sprite of a frame is added
+   void beginFrame();
+
+   void add(const SpriteInstance& instance) { instances.push_back(instance); }
+
+   // Draws the sprites added since the last flush
+   void flush(Renderer& renderer, RenderPass& renderPass);
+
+   // Draws every instance in a buffer that is kept outside the batch, like the tile chunks
+   void draw(Renderer& renderer, RenderPass& renderPass, Buffer<SpriteInstance>& instanceBuffer);
+
+   size_t getSpritesThisFrame() const { return spritesThisFrame; }
+
+private:
+   std::vector<SpriteInstance> instances;
+
+   // One instance buffer per flush in a frame: every write lands before the frame's commands run, so layers can't
+   // share a buffer
+   std::vector<std::shared_ptr<Buffer<SpriteInstance>>> layerBuffers;
+   size_t                                               flushesThisFrame = 0;
+   size_t                                               spritesThisFrame = 0;
+
+   std::shared_ptr<Buffer<SquareObjectVertex>> pointBuffer;
+   std::shared_ptr<IndexBuffer>                indexBuffer;
+   UniformBuffer<SpriteUniform>                uniform;
+};
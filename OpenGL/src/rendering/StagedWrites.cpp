@@ -0,0 +1,31 @@
+#include "StagedWrites.h"
+
+#include <algorithm>
+
+size_t                             StagedWrites::writes          = 0;
+size_t                             StagedWrites::lastFrameWrites = 0;
+std::vector<StagedWrites::Target*> StagedWrites::pending         = {};
+
+void StagedWrites::stage(Target* target) {
+   if (!target->staged) {
+      target->staged = true;
+      pending.push_back(target);
+   }
+}
+
+void StagedWrites::unstage(Target* target) {
+   if (target->staged) {
+      target->staged = false;
+      std::erase(pending, target);
+   }
+}
+
+void StagedWrites::flush() {
+   for (auto* target : pending) {
+      target->writeStaged();
+      target->staged = false;
+   }
+   pending.clear();
+   lastFrameWrites = writes;
+   writes          = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Uniform buffers are written many times a frame (every UniformBufferView::Update). Their writes go into a CPU copy
+// of the buffer and are sent with one queue write per buffer right before the frame's commands are submitted.
+class StagedWrites {
+public:
+   class Target {
+   public:
+      virtual ~Target() = default;
+
+      // Sends the staged bytes to the GPU
+      virtual void writeStaged() = 0;
+
+      bool staged = false;
+   };
+
+   static void stage(Target* target);
+   static void unstage(Target* target);
+
+   // Writes every staged target, called by CommandEncoder before it submits
+   static void flush();
+
+   // Queue writes issued by buffers in the current / last submitted frame
+   static size_t writes;
+   static size_t lastFrameWrites;
+
+private:
+   static std::vector<Target*> pending;
+};
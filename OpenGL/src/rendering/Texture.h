@@ -37,85 +37,27 @@ public:
          return;
       }
 
-      // Calculate image size
-      size_t imageSize = m_Width * m_Height * 4; // 4 bytes per pixel (RGBA8)
-
-      // Define the texture descriptor
-      wgpu::TextureDescriptor textureDesc = {};
-      textureDesc.size.width              = m_Width;
-      textureDesc.size.height             = m_Height;
-      textureDesc.size.depthOrArrayLayers = 1;
-      textureDesc.mipLevelCount           = 1;
-      textureDesc.sampleCount             = 1;
-      textureDesc.dimension               = wgpu::TextureDimension::_2D;
-      textureDesc.format                  = wgpu::TextureFormat::RGBA8Unorm;
-      textureDesc.usage =
-         wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::RenderAttachment;
-
-      // Create the texture
-      texture_ = device_.createTexture(textureDesc);
-      if (!texture_) {
-         std::cerr << "Failed to create texture." << std::endl;
-         stbi_image_free(m_LocalBuffer);
-         m_LocalBuffer = nullptr;
-         return;
-      }
-
-      // Define the texture view descriptor
-      wgpu::TextureViewDescriptor textureViewDesc = {};
-      textureViewDesc.aspect                      = wgpu::TextureAspect::All;
-      textureViewDesc.baseArrayLayer              = 0;
-      textureViewDesc.arrayLayerCount             = 1;
-      textureViewDesc.baseMipLevel                = 0;
-      textureViewDesc.mipLevelCount               = 1;
-      textureViewDesc.dimension                   = wgpu::TextureViewDimension::_2D;
-      textureViewDesc.format                      = textureDesc.format;
-
-      // Create the texture view
-      textureView_ = texture_.createView(textureViewDesc);
-      if (!textureView_) {
-         std::cerr << "Failed to create texture view." << std::endl;
-         texture_.destroy();
-         texture_ = nullptr;
-         stbi_image_free(m_LocalBuffer);
-         m_LocalBuffer = nullptr;
-         return;
-      }
-
-      // Prepare image data for upload
-      std::vector<uint8_t> pixels(imageSize);
-      std::memcpy(pixels.data(), m_LocalBuffer, imageSize);
-
-      // Define the destination for the texture upload
-      wgpu::ImageCopyTexture destination = {};
-      destination.texture                = texture_;
-      destination.mipLevel               = 0;
-      destination.origin                 = {0, 0, 0}; // Equivalent of the offset argument of Queue::writeBuffer
-      destination.aspect                 = wgpu::TextureAspect::All; // Only relevant for depth/Stencil textures
-
-      // Define the data layout of the source image
-      wgpu::TextureDataLayout dataLayout = {};
-      dataLayout.offset                  = 0;
-      dataLayout.bytesPerRow             = 4 * m_Width;
-      dataLayout.rowsPerImage            = m_Height;
-
-      // Define the size of the copy
-      wgpu::Extent3D copySize     = {};
-      copySize.width              = m_Width;
-      copySize.height             = m_Height;
-      copySize.depthOrArrayLayers = 1;
-
-      // Upload the texture data
-      queue_.writeTexture(destination, pixels.data(), pixels.size(), dataLayout, copySize);
-
-      // Associate the sampler (previously created)
-      // If additional sampler-related setup is needed, it can be done here
+      createTexture(m_LocalBuffer);
 
       // Free the local image data as it's no longer needed
       stbi_image_free(m_LocalBuffer);
       m_LocalBuffer = nullptr;
    }
 
+   // Constructor: Creates a WebGPU texture from RGBA8 pixels, `name` only shows up in the log
+   Texture(const std::string& name, const std::vector<uint8_t>& pixels, int width, int height)
+      : id(Id::get())
+      , device_(Application::get().getDevice())
+      , queue_(Application::get().getQueue())
+      , path_(name)
+      , m_Width(width)
+      , m_Height(height)
+      , m_BPP(4) {
+      std::cout << "Initializing texture: " << path_ << " (" << width << "x" << height << ")" << std::endl;
+      assert(pixels.size() == static_cast<size_t>(width) * height * 4);
+      createTexture(pixels.data());
+   }
+
    // Destructor: Releases the texture and associated resources
    ~Texture() {
       if (textureView_) {
@@ -211,6 +153,72 @@ public:
    }
 
 private:
+   // Creates the WebGPU texture and view and uploads the RGBA8 pixels to it
+   void createTexture(const unsigned char* pixels) {
+      // Calculate image size
+      size_t imageSize = m_Width * m_Height * 4; // 4 bytes per pixel (RGBA8)
+
+      // Define the texture descriptor
+      wgpu::TextureDescriptor textureDesc = {};
+      textureDesc.size.width              = m_Width;
+      textureDesc.size.height             = m_Height;
+      textureDesc.size.depthOrArrayLayers = 1;
+      textureDesc.mipLevelCount           = 1;
+      textureDesc.sampleCount             = 1;
+      textureDesc.dimension               = wgpu::TextureDimension::_2D;
+      textureDesc.format                  = wgpu::TextureFormat::RGBA8Unorm;
+      textureDesc.usage =
+         wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::RenderAttachment;
+
+      // Create the texture
+      texture_ = device_.createTexture(textureDesc);
+      if (!texture_) {
+         std::cerr << "Failed to create texture." << std::endl;
+         return;
+      }
+
+      // Define the texture view descriptor
+      wgpu::TextureViewDescriptor textureViewDesc = {};
+      textureViewDesc.aspect                      = wgpu::TextureAspect::All;
+      textureViewDesc.baseArrayLayer              = 0;
+      textureViewDesc.arrayLayerCount             = 1;
+      textureViewDesc.baseMipLevel                = 0;
+      textureViewDesc.mipLevelCount               = 1;
+      textureViewDesc.dimension                   = wgpu::TextureViewDimension::_2D;
+      textureViewDesc.format                      = textureDesc.format;
+
+      // Create the texture view
+      textureView_ = texture_.createView(textureViewDesc);
+      if (!textureView_) {
+         std::cerr << "Failed to create texture view." << std::endl;
+         texture_.destroy();
+         texture_ = nullptr;
+         return;
+      }
+
+      // Define the destination for the texture upload
+      wgpu::ImageCopyTexture destination = {};
+      destination.texture                = texture_;
+      destination.mipLevel               = 0;
+      destination.origin                 = {0, 0, 0}; // Equivalent of the offset argument of Queue::writeBuffer
+      destination.aspect                 = wgpu::TextureAspect::All; // Only relevant for depth/Stencil textures
+
+      // Define the data layout of the source image
+      wgpu::TextureDataLayout dataLayout = {};
+      dataLayout.offset                  = 0;
+      dataLayout.bytesPerRow             = 4 * m_Width;
+      dataLayout.rowsPerImage            = m_Height;
+
+      // Define the size of the copy
+      wgpu::Extent3D copySize     = {};
+      copySize.width              = m_Width;
+      copySize.height             = m_Height;
+      copySize.depthOrArrayLayers = 1;
+
+      // Upload the texture data
+      queue_.writeTexture(destination, pixels, imageSize, dataLayout, copySize);
+   }
+
    wgpu::Device&     device_;
    wgpu::Queue&      queue_;
    wgpu::Texture     texture_     = nullptr;
@@ -0,0 +1,120 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr int PADDING = 1;
+
+struct Image {
+   std::string          path;
+   int                  width;
+   int                  height;
+   std::vector<uint8_t> pixels;
+   glm::ivec2           position; // Of the top left pixel inside the padding
+};
+
+std::vector<Image> loadImages(const std::filesystem::path& directory) {
+   std::vector<Image> images;
+   stbi_set_flip_vertically_on_load(1); // Same orientation as Texture
+   for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+      if (!entry.is_regular_file() || entry.path().extension() != ".png") {
+         continue;
+      }
+      Image image;
+      image.path      = std::filesystem::relative(entry.path(), directory).generic_string();
+      int   bpp       = 0;
+      auto  stbi_path = entry.path().string();
+      auto* data      = stbi_load(stbi_path.c_str(), &image.width, &image.height, &bpp, 4); // Force RGBA
+      if (!data) {
+         std::cerr << "Failed to load image: " << entry.path() << std::endl;
+         continue;
+      }
+      image.pixels.assign(data, data + static_cast<size_t>(image.width) * image.height * 4);
+      stbi_image_free(data);
+      images.push_back(std::move(image));
+   }
+   return images;
+}
+
+// Places the images on rows of an atlas `width` pixels wide and returns the height used
+int packShelves(std::vector<Image>& images, int width) {
+   std::sort(images.begin(), images.end(), [](const Image& a, const Image& b) { return a.height > b.height; });
+
+   glm::ivec2 cursor(0, 0);
+   int        shelfHeight = 0;
+   for (auto& image : images) {
+      int paddedWidth  = image.width + 2 * PADDING;
+      int paddedHeight = image.height + 2 * PADDING;
+      if (cursor.x + paddedWidth > width) {
+         cursor      = {0, cursor.y + shelfHeight};
+         shelfHeight = 0;
+      }
+      image.position = cursor + PADDING;
+
+      cursor.x += paddedWidth;
+      shelfHeight = std::max(shelfHeight, paddedHeight);
+   }
+   return cursor.y + shelfHeight;
+}
+
+// Copies the image into the atlas, repeating its edge pixels into the padding around it
+void blit(const Image& image, std::vector<uint8_t>& atlas, int atlasWidth) {
+   for (int y = -PADDING; y < image.height + PADDING; y++) {
+      int sourceY = std::clamp(y, 0, image.height - 1);
+      for (int x = -PADDING; x < image.width + PADDING; x++) {
+         int    sourceX = std::clamp(x, 0, image.width - 1);
+         size_t from    = (static_cast<size_t>(sourceY) * image.width + sourceX) * 4;
+         size_t to      = (static_cast<size_t>(image.position.y + y) * atlasWidth + image.position.x + x) * 4;
+         std::copy_n(&image.pixels[from], 4, &atlas[to]);
+      }
+   }
+}
+
+} // namespace
+
+TextureAtlas& TextureAtlas::get() {
+   static TextureAtlas atlas;
+   return atlas;
+}
+
+TextureAtlas::TextureAtlas() {
+   auto images = loadImages(Application::get().res_path / "textures");
+
+   // Start with a square big enough for all images and widen it until the shelves fit
+   size_t area     = 0;
+   int    minWidth = 1;
+   for (const auto& image : images) {
+      area += static_cast<size_t>(image.width + 2 * PADDING) * (image.height + 2 * PADDING);
+      minWidth = std::max(minWidth, image.width + 2 * PADDING);
+   }
+   int width  = std::max(static_cast<int>(std::bit_ceil(static_cast<size_t>(std::ceil(std::sqrt(area))))),
+                         static_cast<int>(std::bit_ceil(static_cast<size_t>(minWidth))));
+   int height = packShelves(images, width);
+   while (height > width) {
+      width *= 2;
+      height = packShelves(images, width);
+   }
+   height = std::max(height, 1);
+
+   std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4, 0);
+   for (const auto& image : images) {
+      blit(image, pixels, width);
+      glm::vec2 size(width, height);
+      regions[image.path] = glm::vec4(glm::vec2(image.position) / size, glm::vec2(image.width, image.height) / size);
+   }
+
+   texture = std::make_unique<Texture>("Texture Atlas", pixels, width, height);
+}
+
+glm::vec4 TextureAtlas::region(const std::string& path) const {
+   auto it = regions.find(path);
+   if (it == regions.end()) {
+      std::cerr << "Texture not in atlas: " << path << std::endl;
+      assert(false);
+      return glm::vec4(0.0f);
+   }
+   return it->second;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "Texture.h"
+
+// Every image under res/textures packed into one texture when it is first used, so all sprites can be drawn with the
+// same bind group. Images are placed on shelves, tallest first, each with a 1px border of its own edge pixels so
+// neighbouring sprites can't bleed into each other.
+class TextureAtlas {
+public:
+   static TextureAtlas& get();
+
+   // UV rect of an image, with its offset in xy and its size in zw. `path` is relative to res/textures, like the paths
+   // given to Texture::create.
+   glm::vec4 region(const std::string& path) const;
+
+   Texture* getTexture() const { return texture.get(); }
+
+private:
+   TextureAtlas();
+
+   std::unique_ptr<Texture>                   texture;
+   std::unordered_map<std::string, glm::vec4> regions;
+};
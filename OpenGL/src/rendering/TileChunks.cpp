@@ -0,0 +1,75 @@
+#include "TileChunks.h"
+
+#include <cmath>
+#include "../game_objects/Tile.h"
+
+namespace {
+
+// Degenerate sprite for slots that no longer hold a tile
+const SpriteInstance EMPTY_SLOT(glm::mat4(0.0f), glm::vec4(0.0f), 0.0f, glm::vec4(0.0f));
+
+} // namespace
+
+glm::ivec2 TileChunks::chunkOf(glm::ivec2 tile) {
+   auto floorDiv = [](int value) { return (value >= 0 ? value : value - CHUNK_SIZE + 1) / CHUNK_SIZE; };
+   return {floorDiv(tile.x), floorDiv(tile.y)};
+}
+
+void TileChunks::clear() {
+   pending.clear();
+   slots.clear();
+   chunks.clear();
+}
+
+void TileChunks::remove(Tile* tile) {
+   pending.erase(tile);
+   auto slot = slots.find(tile);
+   if (slot != slots.end()) {
+      slot->second.instance.Update(EMPTY_SLOT);
+      slots.erase(slot); // Frees the index for the next tile added to the chunk
+   }
+}
+
+void TileChunks::sync() {
+   for (auto* tile : pending) {
+      glm::ivec3     chunkPosition(chunkOf(tile->getTile()), static_cast<int>(tile->drawPriority));
+      SpriteInstance instance = tile->getSpriteInstance();
+
+      auto slot = slots.find(tile);
+      if (slot != slots.end() && slot->second.chunk == chunkPosition) {
+         slot->second.instance.Update(instance);
+         continue;
+      }
+
+      // New tile, or it moved to another chunk or draw priority
+      if (slot != slots.end()) {
+         slot->second.instance.Update(EMPTY_SLOT);
+         slots.erase(slot);
+      }
+      auto& chunk = chunks[chunkPosition];
+      if (!chunk) {
+         chunk = std::make_shared<Buffer<SpriteInstance>>(
+            std::vector<SpriteInstance>{},
+            wgpu::bothBufferUsages(wgpu::BufferUsage::CopyDst, wgpu::BufferUsage::CopySrc, wgpu::BufferUsage::Vertex),
+            "Tile Chunk");
+      }
+      slots.insert_or_assign(tile, Slot{chunkPosition, chunk->Add(instance)});
+   }
+   pending.clear();
+}
+
+void TileChunks::render(DrawPriority layer, Renderer& renderer, RenderPass& renderPass) {
+   // Tiles are unit squares centered on their tile, so chunks reach half a tile past their tile range
+   glm::vec4  view  = CalculateViewBounds();
+   glm::ivec2 first = chunkOf(glm::ivec2(glm::floor(glm::vec2(view.x, view.y) + 0.5f)));
+   glm::ivec2 last  = chunkOf(glm::ivec2(glm::floor(glm::vec2(view.z, view.w) + 0.5f)));
+   for (int x = first.x; x <= last.x; x++) {
+      for (int y = first.y; y <= last.y; y++) {
+         auto chunk = chunks.find(glm::ivec3(x, y, static_cast<int>(layer)));
+         if (chunk != chunks.end() && chunk->second->count() > 0) {
+            renderer.sprites.draw(renderer, renderPass, *chunk->second);
+            chunksDrawn++;
+         }
+      }
+   }
+}
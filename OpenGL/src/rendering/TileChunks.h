@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <glm/glm.hpp>
+#ifndef GLM_ENABLE_EXPERIMENTAL
+#define GLM_ENABLE_EXPERIMENTAL
+#endif
+#include <glm/gtx/hash.hpp>
+#include "Buffer.h"
+#include "DataFormats.h"
+#include "../game_objects/GameObject.h"
+
+class Tile;
+
+// Tiles baked into persistent instance buffers, one per CHUNK_SIZE x CHUNK_SIZE block of tiles and draw priority.
+// Every tile owns a slot in its chunk that is only rewritten when the tile's sprite changes, and only the chunks
+// overlapping the camera are drawn, so the per frame cost doesn't grow with the map.
+class TileChunks {
+public:
+   static constexpr int CHUNK_SIZE = 32;
+
+   void clear();
+   void add(Tile* tile) { pending.insert(tile); }
+   void remove(Tile* tile);
+
+   // Call when a tile's sprite or draw priority changes, the chunk is patched on the next sync()
+   void update(Tile* tile) { pending.insert(tile); }
+
+   // Writes the pending tiles into their chunks. Chunk buffers can grow here, which copies on the frame's encoder, so
+   // this has to run outside of a pass.
+   void sync();
+
+   // Resets the per frame counters
+   void beginFrame() { chunksDrawn = 0; }
+
+   // Draws the chunks of `layer` that the camera can see
+   void render(DrawPriority layer, Renderer& renderer, RenderPass& renderPass);
+
+   size_t getChunkCount() const { return chunks.size(); }
+   size_t getChunksDrawn() const { return chunksDrawn; }
+
+private:
+   struct Slot {
+      glm::ivec3                        chunk; // Chunk position and draw priority
+      BufferView<SpriteInstance, false> instance;
+   };
+
+   static glm::ivec2 chunkOf(glm::ivec2 tile);
+
+   std::unordered_map<glm::ivec3, std::shared_ptr<Buffer<SpriteInstance>>> chunks;
+   std::unordered_map<const Tile*, Slot>                                   slots;
+   std::unordered_set<Tile*>                                               pending;
+   size_t                                                                  chunksDrawn = 0;
+};
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/BVH.h"
+#include "geometry/WallChunks.h"
+
+// Build and query times of the wall BVH on the shipped maps and on large random mazes. Not a test, run it by hand
+// (in a release build) after changing the BVH.
+
+// The builder the surface area heuristic replaced: a median split on the longest axis with a full sort at every level,
+// and a node holding a single segment bucket at every leaf
+size_t medianBuildRecursive(BVH& bvh, size_t segment_start, size_t segment_end, uint32_t depth) {
+   AABB aabb = bvh.compute_aabb(segment_start, segment_end);
+   bvh.depth = std::max(bvh.depth, depth + 1);
+
+   BvhNode node;
+   if (segment_end - segment_start <= 1) {
+      node.setLeft(1, static_cast<uint32_t>(segment_end - segment_start));
+      node.leftOffset = static_cast<uint32_t>(segment_start);
+      node.leftBBox   = glm::vec4(aabb.min, aabb.max);
+      node.setRight(0, 0);
+      node.rightOffset = 0;
+      node.rightBBox   = glm::vec4(0.0f);
+      bvh.nodes.push_back(node);
+      return bvh.nodes.size() - 1;
+   }
+
+   bool vertical = aabb.max.y - aabb.min.y > aabb.max.x - aabb.min.x;
+   auto centroid = [vertical](const Segment& segment) {
+      return vertical ? segment.start.y + segment.end.y : segment.start.x + segment.end.x;
+   };
+   std::sort(bvh.segments.begin() + segment_start, bvh.segments.begin() + segment_end,
+             [&](const Segment& a, const Segment& b) { return centroid(a) < centroid(b); });
+   size_t mid = (segment_start + segment_end) / 2;
+
+   size_t left  = medianBuildRecursive(bvh, segment_start, mid, depth + 1);
+   size_t right = medianBuildRecursive(bvh, mid, segment_end, depth + 1);
+   node.setLeft(0, 0);
+   node.leftOffset = static_cast<uint32_t>(left);
+   node.leftBBox   = bvh.getBoundingBoxOfNode(bvh.nodes[left]);
+   node.setRight(0, 0);
+   node.rightOffset = static_cast<uint32_t>(right);
+   node.rightBBox   = bvh.getBoundingBoxOfNode(bvh.nodes[right]);
+   bvh.nodes.push_back(node);
+   return bvh.nodes.size() - 1;
+}
+
+BVH medianBuild(std::vector<Segment> segments) {
+   BVH bvh;
+   bvh.segments = std::move(segments);
+   if (!bvh.segments.empty()) {
+      medianBuildRecursive(bvh, 0, bvh.segments.size(), 0);
+   }
+   return bvh;
+}
+
+struct Scene {
+   std::string          name;
+   std::vector<Segment> segments;
+   std::vector<Ray>     rays;
+   std::vector<Segment> queries; // Line of sight checks, a few tiles long
+};
+
+Scene makeScene(std::string name, const std::vector<glm::ivec2>& walls, std::mt19937& random) {
+   WallChunks chunks;
+   glm::vec2  min(std::numeric_limits<float>::max());
+   glm::vec2  max(std::numeric_limits<float>::lowest());
+   for (auto wall : walls) {
+      chunks.setWall(wall, true);
+      min = glm::min(min, glm::vec2(wall));
+      max = glm::max(max, glm::vec2(wall));
+   }
+   // Only the walls, without the empty segments padding the merged arrays for chunks to grow into
+   Scene scene{std::move(name), chunks.assemble().bvh.segments, {}, {}};
+   std::erase_if(scene.segments, [](const Segment& segment) { return segment.start == segment.end; });
+
+   std::uniform_real_distribution<float> x(min.x, max.x);
+   std::uniform_real_distribution<float> y(min.y, max.y);
+   std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+   for (int i = 0; i < 20000; i++) {
+      glm::vec2 origin(x(random), y(random));
+      float     a = angle(random);
+      glm::vec2 direction(std::cos(a), std::sin(a));
+      scene.rays.push_back({origin, direction});
+      scene.queries.push_back({origin, origin + direction * 6.0f});
+   }
+   return scene;
+}
+
+// Best of a few runs, in milliseconds
+template <typename F>
+double timeMs(int runs, F run) {
+   double best = std::numeric_limits<double>::infinity();
+   for (int i = 0; i < runs; i++) {
+      auto start = std::chrono::steady_clock::now();
+      run();
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      best                                              = std::min(best, elapsed.count());
+   }
+   return best;
+}
+
+// Hits are counted and printed so the queries can't be optimized away
+size_t hits = 0;
+
+void compareBuilders(const Scene& scene) {
+   BVH    median;
+   BVH    sah;
+   double medianBuildMs = timeMs(5, [&] { median = medianBuild(scene.segments); });
+   double sahBuildMs    = timeMs(5, [&] { sah = BVH::build(scene.segments); });
+
+   auto perQueryNs = [&](const BVH& bvh, bool rays) {
+      size_t count = rays ? scene.rays.size() : scene.queries.size();
+      double ms    = timeMs(5, [&] {
+         for (size_t i = 0; i < count; i++) {
+            hits += (rays ? bvh.ray_intersect(scene.rays[i]) : bvh.segment_intersect(scene.queries[i])).has_value();
+         }
+      });
+      return ms * 1e6 / static_cast<double>(count);
+   };
+
+   std::cout << scene.name << ": " << scene.segments.size() << " segments\n"
+             << std::fixed << std::setprecision(2) << "   median: " << std::setw(8) << medianBuildMs << " ms build, "
+             << std::setw(7) << perQueryNs(median, true) << " ns/ray, " << std::setw(7) << perQueryNs(median, false)
+             << " ns/segment, " << median.nodes.size() << " nodes, depth " << median.depth << "\n"
+             << "   SAH:    " << std::setw(8) << sahBuildMs << " ms build, " << std::setw(7) << perQueryNs(sah, true)
+             << " ns/ray, " << std::setw(7) << perQueryNs(sah, false) << " ns/segment, " << sah.nodes.size()
+             << " nodes, depth " << sah.depth << "\n";
+}
+
+void compareBatches(const Scene& scene) {
+   BVH                   bvh = BVH::build(scene.segments);
+   std::vector<BVH::Hit> results(scene.rays.size());
+
+   // Times one way of answering all the queries, in nanoseconds per query
+   auto perQueryNs = [&](auto answer) {
+      double ms = timeMs(5, answer);
+      hits += std::count_if(results.begin(), results.end(), [](const BVH::Hit& hit) { return hit.has_value(); });
+      return ms * 1e6 / static_cast<double>(results.size());
+   };
+   double singleRays = perQueryNs([&] {
+      for (size_t i = 0; i < scene.rays.size(); i++) {
+         results[i] = bvh.ray_intersect(scene.rays[i]);
+      }
+   });
+   double batchRays      = perQueryNs([&] { bvh.ray_intersect_batch(scene.rays, results); });
+   double singleSegments = perQueryNs([&] {
+      for (size_t i = 0; i < scene.queries.size(); i++) {
+         results[i] = bvh.segment_intersect(scene.queries[i]);
+      }
+   });
+   double batchSegments = perQueryNs([&] { bvh.segment_intersect_batch(scene.queries, results); });
+
+   std::cout << scene.name << ":\n"
+             << std::fixed << std::setprecision(2) << "   rays:     " << std::setw(7) << singleRays
+             << " ns one at a time, " << std::setw(7) << batchRays << " ns in packets\n"
+             << "   segments: " << std::setw(7) << singleSegments << " ns one at a time, " << std::setw(7)
+             << batchSegments << " ns in packets\n";
+}
+
+int main() {
+   std::mt19937       random(7);
+   std::vector<Scene> scenes;
+   for (const auto& map : mapFiles()) {
+      auto walls = loadWalls(map);
+      if (!walls.empty()) {
+         scenes.push_back(makeScene(map.filename().string(), walls, random));
+      }
+   }
+   for (int rooms : {25, 50, 100}) {
+      scenes.push_back(makeScene("maze of " + std::to_string(rooms * rooms) + " rooms",
+                                 randomWalls(random, rooms, 0.5f), random));
+   }
+
+   std::cout << "Surface area heuristic against median split builds\n";
+   for (const auto& scene : scenes) {
+      compareBuilders(scene);
+   }
+
+   // The visibility pass casts rays from one position, which packets share the traversal of best
+   std::cout << "\nPacket queries against one query at a time\n";
+   for (const auto& scene : scenes) {
+      compareBatches(scene);
+   }
+   for (auto& scene : scenes) {
+      for (size_t i = 0; i < scene.rays.size(); i++) {
+         scene.rays[i].origin    = scene.rays[0].origin;
+         scene.queries[i].end   += scene.rays[0].origin - scene.queries[i].start;
+         scene.queries[i].start  = scene.rays[0].origin;
+      }
+      scene.name += ", from one position";
+      compareBatches(scene);
+   }
+
+   std::cout << "(" << hits << " hits)" << std::endl;
+   return 0;
+}
@@ -0,0 +1,152 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/BVH.h"
+#include "geometry/WallChunks.h"
+
+// Levels of nodes on the longest path from the node down, counted by walking the tree
+uint32_t measureDepth(const BVH& bvh, uint32_t node) {
+   const BvhNode& n     = bvh.nodes[node];
+   uint32_t       below = 0;
+   if (n.getLeftType() == 0) {
+      below = std::max(below, measureDepth(bvh, n.leftOffset));
+   }
+   if (n.getRightType() == 0 && n.rightBBox != glm::vec4(0.0f)) {
+      below = std::max(below, measureDepth(bvh, n.rightOffset));
+   }
+   return below + 1;
+}
+
+uint32_t measureDepth(const BVH& bvh) {
+   return bvh.nodes.empty() ? 0 : measureDepth(bvh, static_cast<uint32_t>(bvh.nodes.size() - 1));
+}
+
+// Distance to the closest segment along the ray, checking every segment
+float bruteForce(const std::vector<Segment>& segments, const Ray& ray) {
+   float closest = std::numeric_limits<float>::infinity();
+   for (const auto& segment : segments) {
+      if (auto hit = intersect_ray_segment(ray, segment)) {
+         closest = std::min(closest, glm::distance(ray.origin, hit->first));
+      }
+   }
+   return closest;
+}
+
+// The tree has to stay within the traversal stack, and neither the single nor the packet traversal may lose a child
+// on the way, which would show up as a missed or farther hit
+void checkTree(const std::string& name, const BVH& bvh, const std::vector<Segment>& segments, uint32_t maxDepth,
+               std::mt19937& random) {
+   uint32_t depth = measureDepth(bvh);
+   check(depth == bvh.depth, name + ": depth " + std::to_string(bvh.depth) + " but measured " + std::to_string(depth));
+   check(depth <= maxDepth, name + ": " + std::to_string(depth) + " levels, more than " + std::to_string(maxDepth));
+   check(depth + 1 <= BVH_STACK_SIZE, name + ": too deep for the traversal stack");
+
+   glm::vec4 box(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+   for (const auto& segment : segments) {
+      box = glm::vec4(glm::min(glm::vec2(box.x, box.y), glm::min(segment.start, segment.end)),
+                      glm::max(glm::vec2(box.z, box.w), glm::max(segment.start, segment.end)));
+   }
+   std::uniform_real_distribution<float> x(box.x, box.z);
+   std::uniform_real_distribution<float> y(box.y, box.w);
+   std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+   std::vector<Ray> rays(203);
+   for (auto& ray : rays) {
+      float a = angle(random);
+      ray     = Ray{
+         {x(random), y(random)},
+         {std::cos(a), std::sin(a)}
+      };
+   }
+   std::vector<BVH::Hit> batch(rays.size());
+   bvh.ray_intersect_batch(rays, batch);
+
+   int mismatches = 0;
+   for (size_t i = 0; i < rays.size(); i++) {
+      float expected = bruteForce(segments, rays[i]);
+      auto  single   = bvh.ray_intersect(rays[i]);
+      for (const auto& hit : {single, batch[i]}) {
+         float found = hit ? glm::distance(rays[i].origin, hit->first) : std::numeric_limits<float>::infinity();
+         mismatches += !(found == expected || std::abs(found - expected) <= 1e-3f * std::max(1.0f, expected));
+      }
+   }
+   check(mismatches == 0, name + ": " + std::to_string(mismatches) + " hits differ from checking every segment");
+}
+
+int main() {
+   std::mt19937 random(99);
+
+   std::vector<std::pair<std::string, std::vector<Segment>>> sets;
+
+   // Segments spaced exponentially, where every surface area heuristic split cuts off one segment and the tree would
+   // be as deep as there are segments without the depth limit
+   std::vector<Segment> exponential;
+   for (int i = 0; i < 120; i++) {
+      float position = std::ldexp(1.0f, i / 2 - 30) * (1.0f + i % 2 * 0.5f);
+      exponential.push_back({
+         {position, 0.0f},
+         {position, 1.0f}
+      });
+   }
+   sets.emplace_back("exponential spacing", exponential);
+
+   // Many copies of the same segment, which can't be split apart at all
+   std::vector<Segment> duplicates(300, Segment{
+                                           {0.0f, 0.0f},
+                                           {1.0f, 1.0f}
+   });
+   duplicates.push_back({
+      {2.0f, 0.0f},
+      {2.0f, 5.0f}
+   });
+   sets.emplace_back("duplicates", duplicates);
+
+   std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+   std::vector<Segment>                  scattered;
+   for (int i = 0; i < 5000; i++) {
+      glm::vec2 start(coordinate(random), coordinate(random));
+      scattered.push_back({start, start + glm::vec2(coordinate(random), coordinate(random)) * 0.02f});
+   }
+   sets.emplace_back("random segments", scattered);
+
+   for (const auto& map : mapFiles()) {
+      WallChunks chunks;
+      for (auto wall : loadWalls(map)) {
+         chunks.setWall(wall, true);
+      }
+      // Only the walls, without the empty segments padding the merged arrays for chunks to grow into
+      auto segments = chunks.assemble().bvh.segments;
+      std::erase_if(segments, [](const Segment& segment) { return segment.start == segment.end; });
+      sets.emplace_back(map.filename().string(), std::move(segments));
+   }
+
+   for (const auto& [name, segments] : sets) {
+      if (segments.empty()) {
+         continue;
+      }
+      for (uint32_t maxDepth : {1u, 2u, 5u, 9u, 20u, BVH_MAX_BUILD_DEPTH, 1000u}) {
+         for (uint32_t maxLeafSize : {1u, 4u}) {
+            BvhBuildOptions options;
+            options.maxDepth    = maxDepth;
+            options.maxLeafSize = maxLeafSize;
+            BVH bvh             = BVH::build(segments, options);
+            checkTree(name + " (max depth " + std::to_string(maxDepth) + ", leaf size " + std::to_string(maxLeafSize) +
+                         ")",
+                      bvh, segments, std::min(maxDepth, BVH_MAX_BUILD_DEPTH), random);
+         }
+      }
+   }
+
+   // The merged walls, including the top level over the chunks, also have to fit
+   WallChunks maze;
+   for (auto wall : randomWalls(random, 60, 0.6f)) {
+      maze.setWall(wall, true);
+   }
+   const auto& walls = maze.assemble();
+   checkTree("merged maze", walls.bvh, walls.bvh.segments, BVH_STACK_SIZE - 1, random);
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}
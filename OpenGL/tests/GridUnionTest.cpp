@@ -0,0 +1,47 @@
+#include <cmath>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/GeometryUtils.h"
+
+using namespace GeometryUtils;
+
+// findGridUnion has to cover exactly what the general-purpose Clipper union of the tile squares covers
+void checkGridUnion(const std::vector<glm::ivec2>& walls, const std::string& name) {
+   PolyTreeD gridTree;
+   findGridUnion(walls, gridTree);
+   PathsD grid = FlattenPolyPathD(gridTree, false);
+
+   std::vector<std::vector<glm::vec2>> squares;
+   for (auto wall : walls) {
+      glm::vec2 center(wall);
+      squares.push_back({center + glm::vec2{-0.5, -0.5}, center + glm::vec2{0.5, -0.5}, center + glm::vec2{0.5, 0.5},
+                         center + glm::vec2{-0.5, 0.5}});
+   }
+   PolyTreeD clipperTree;
+   findPolygonUnion(squares, clipperTree);
+   PathsD clipper = FlattenPolyPathD(clipperTree, false);
+
+   // Outlines are counter-clockwise and holes clockwise, so the signed areas add up to the number of tiles
+   check(std::abs(Area(grid) - static_cast<double>(walls.size())) < 1e-6, name + ": grid union area");
+   check(std::abs(Area(Xor(grid, clipper, FillRule::NonZero))) < 1e-6, name + ": grid union differs from Clipper");
+   for (const auto& path : grid) {
+      for (const auto& point : path) {
+         check(point.x * 2 == std::round(point.x * 2) && point.y * 2 == std::round(point.y * 2),
+               name + ": corner off the grid");
+      }
+   }
+}
+
+int main() {
+   for (const auto& map : mapFiles()) {
+      checkGridUnion(loadWalls(map), map.filename().string());
+   }
+
+   std::mt19937 random(1234);
+   for (int i = 0; i < 50; i++) {
+      checkGridUnion(randomWalls(random, 1 + i % 8, 0.5f), "random maze " + std::to_string(i));
+   }
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}
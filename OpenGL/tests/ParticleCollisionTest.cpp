@@ -0,0 +1,89 @@
+#include <cmath>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/ParticleCollision.h"
+#include "geometry/WallChunks.h"
+
+using namespace ParticleCollision;
+
+// The BVH walk of bvh.wgsl (as copied by ParticleCollision) has to find the same closest wall as the loop over every
+// segment the shader used before
+void checkLayout(const std::string& name, const BVH& bvh, glm::vec2 min, glm::vec2 max, std::mt19937& random) {
+   std::uniform_real_distribution<float> x(min.x, max.x);
+   std::uniform_real_distribution<float> y(min.y, max.y);
+   std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+   std::uniform_real_distribution<float> length(0.0f, 3.0f);
+
+   int hits       = 0;
+   int mismatches = 0;
+   for (int i = 0; i < 5000; i++) {
+      glm::vec2 from(x(random), y(random));
+      float     a = angle(random);
+      glm::vec2 to = from + glm::vec2(std::cos(a), std::sin(a)) * length(random);
+      // Particles moving along an axis, which the slab test has to handle without dividing by zero
+      if (i % 10 == 0) {
+         to = {to.x, from.y};
+      } else if (i % 10 == 1) {
+         to = {from.x, to.y};
+      }
+
+      WallCollision expected;
+      for (const auto& wall : bvh.segments) {
+         auto intersection = intersectWall(Segment{from, to}, wall);
+         if (intersection.hit && intersection.t < expected.t) {
+            expected = intersection;
+         }
+      }
+      WallCollision found = findWallCollision(bvh, from, to);
+
+      bool same = found.hit == expected.hit;
+      if (same && expected.hit) {
+         same = std::abs(found.t - expected.t) <= 1e-6f && glm::distance(found.position, expected.position) <= 1e-4f;
+      }
+      hits += expected.hit;
+      mismatches += !same;
+   }
+   check(hits > 0, name + ": no particle paths hit a wall");
+   check(mismatches == 0, name + ": " + std::to_string(mismatches) + " paths hit a different wall than the scan");
+}
+
+int main() {
+   std::mt19937 random(11);
+
+   auto addWalls = [&](const std::string& name, const std::vector<glm::ivec2>& walls) {
+      if (walls.empty()) {
+         return;
+      }
+      WallChunks chunks;
+      glm::vec2  min(walls.front());
+      glm::vec2  max(walls.front());
+      for (auto wall : walls) {
+         chunks.setWall(wall, true);
+         min = glm::min(min, glm::vec2(wall));
+         max = glm::max(max, glm::vec2(wall));
+      }
+      const BVH& merged = chunks.assemble().bvh;
+      checkLayout(name, merged, min, max, random);
+
+      // Built in one piece, with larger buckets and with a tight depth limit
+      for (uint32_t maxLeafSize : {1u, 4u, 16u}) {
+         BvhBuildOptions options;
+         options.maxLeafSize = maxLeafSize;
+         options.maxDepth    = maxLeafSize == 16 ? 3 : BVH_MAX_BUILD_DEPTH;
+         checkLayout(name + " (leaf size " + std::to_string(maxLeafSize) + ")", BVH::build(merged.segments, options),
+                     min, max, random);
+      }
+   };
+   for (const auto& map : mapFiles()) {
+      addWalls(map.filename().string(), loadWalls(map));
+   }
+   for (int i = 0; i < 5; i++) {
+      addWalls("random maze " + std::to_string(i), randomWalls(random, 3 + i * 4, 0.5f));
+   }
+
+   // No walls at all
+   check(!findWallCollision(BVH{}, {0, 0}, {1, 1}).hit, "hit a wall in an empty BVH");
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}
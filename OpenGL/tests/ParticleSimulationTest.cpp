@@ -0,0 +1,103 @@
+#include <cmath>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/ParticleCollision.h"
+#include "geometry/ParticleSimulation.h"
+#include "geometry/WallChunks.h"
+
+// Particles flying around a layout, stepped by the CPU backend and, one particle at a time, by ParticleCollision (the
+// copy of the compute shader). Every step starts both from the backend's state, so rounding differences can't grow
+// into different paths, and then has to agree particle by particle.
+void checkSimulation(const std::string& name, const BVH& bvh, glm::vec2 min, glm::vec2 max, size_t count,
+                     std::mt19937& random) {
+   std::uniform_real_distribution<float> x(min.x, max.x);
+   std::uniform_real_distribution<float> y(min.y, max.y);
+   std::uniform_real_distribution<float> velocity(-20.0f, 20.0f);
+   std::uniform_real_distribution<float> lifetime(0.5f, 3.0f);
+
+   ParticleState state;
+   for (size_t i = 0; i < count; i++) {
+      // Every tenth particle moves along an axis
+      glm::vec2 v(velocity(random), velocity(random));
+      if (i % 10 == 0) {
+         v.y = 0.0f;
+      }
+      state.add({x(random), y(random)}, v, glm::vec4(1.0f), 0.0f, lifetime(random));
+   }
+
+   size_t bounces    = 0;
+   size_t mismatches = 0;
+   for (int frame = 0; frame < 60; frame++) {
+      float deltaTime = frame % 2 == 0 ? 1.0f / 60.0f : 1.0f / 30.0f;
+
+      ParticleState before = state;
+      ParticleSimulation::stepAll(state, bvh, deltaTime);
+      check(state.live == before.live, name + ": stepping changed the number of live particles");
+
+      for (size_t i = 0; i < state.live; i++) {
+         glm::vec2 position(before.positionX[i], before.positionY[i]);
+         glm::vec2 v(before.velocityX[i], before.velocityY[i]);
+         float     age = before.age[i];
+         ParticleCollision::step(bvh, position, v, age, deltaTime);
+
+         bounces += v != glm::vec2(before.velocityX[i], before.velocityY[i]);
+         bool same = glm::distance(position, glm::vec2(state.positionX[i], state.positionY[i])) <= 1e-3f &&
+                     glm::distance(v, glm::vec2(state.velocityX[i], state.velocityY[i])) <= 1e-3f &&
+                     std::abs(age - state.age[i]) <= 1e-6f;
+         mismatches += !same;
+      }
+
+      ParticleSimulation::compact(state);
+   }
+   check(bounces > 0, name + ": no particle bounced off a wall");
+   // A path grazing the end of a wall can count as a hit in one and a miss in the other
+   check(mismatches * 10000 <= bounces, name + ": " + std::to_string(mismatches) + " particle steps of " +
+                                           std::to_string(bounces) + " bounces differ from the shader");
+}
+
+// Dead particles are dropped and the live ones keep their order
+void checkCompact(std::mt19937& random) {
+   std::uniform_real_distribution<float> value(0.0f, 1.0f);
+   ParticleState                         state;
+   std::vector<float>                    kept;
+   for (int i = 0; i < 1000; i++) {
+      float age = value(random);
+      state.add({static_cast<float>(i), 0.0f}, {}, glm::vec4(1.0f), age, 0.5f);
+      if (age < 0.5f) {
+         kept.push_back(static_cast<float>(i));
+      }
+   }
+   ParticleSimulation::compact(state);
+   check(state.live == kept.size(), "compact kept " + std::to_string(state.live) + " particles instead of " +
+                                       std::to_string(kept.size()));
+   check(std::equal(kept.begin(), kept.end(), state.positionX.begin()), "compact reordered the live particles");
+}
+
+int main() {
+   std::mt19937 random(12);
+
+   auto addWalls = [&](const std::string& name, const std::vector<glm::ivec2>& walls, size_t count) {
+      if (walls.empty()) {
+         return;
+      }
+      WallChunks chunks;
+      glm::vec2  min(walls.front());
+      glm::vec2  max(walls.front());
+      for (auto wall : walls) {
+         chunks.setWall(wall, true);
+         min = glm::min(min, glm::vec2(wall));
+         max = glm::max(max, glm::vec2(wall));
+      }
+      checkSimulation(name, chunks.assemble().bvh, min, max, count, random);
+   };
+   for (const auto& map : mapFiles()) {
+      addWalls(map.filename().string(), loadWalls(map), 1000);
+   }
+   // Enough particles to be split over threads
+   addWalls("random maze", randomWalls(random, 10, 0.5f), 4 * ParticleSimulation::PARALLEL_THRESHOLD + 123);
+
+   checkCompact(random);
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Shared helpers for the geometry tests and benchmarks, which run without a window or GPU
+
+// The maps shipped in res/maps, sorted by name
+inline std::vector<std::filesystem::path> mapFiles() {
+   std::vector<std::filesystem::path> maps;
+   for (const auto& entry : std::filesystem::directory_iterator(MAPS_PATH)) {
+      if (entry.path().extension() == ".txt") {
+         maps.push_back(entry.path());
+      }
+   }
+   std::sort(maps.begin(), maps.end());
+   return maps;
+}
+
+// Wall tiles of a map, at the positions World::LoadMap gives them
+inline std::vector<glm::ivec2> loadWalls(const std::filesystem::path& path) {
+   std::ifstream            file(path);
+   std::vector<std::string> lines;
+   std::string              line;
+   while (std::getline(file, line)) {
+      lines.push_back(std::move(line));
+   }
+
+   std::vector<glm::ivec2> walls;
+   for (size_t row = 0; row < lines.size(); ++row) {
+      for (size_t x = 0; x < lines[row].length(); ++x) {
+         if (lines[row][x] == 'w' || lines[row][x] == 'W') {
+            walls.emplace_back(static_cast<int>(x), static_cast<int>(lines.size() - row));
+         }
+      }
+   }
+   return walls;
+}
+
+// Wall tiles of a random maze-like map: a grid of rooms with every wall between them kept with probability `density`
+template <typename Random>
+std::vector<glm::ivec2> randomWalls(Random& random, int rooms, float density) {
+   std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+   std::vector<glm::ivec2>               walls;
+   int                                   size = rooms * 4;
+   for (int y = 0; y <= size; y++) {
+      for (int x = 0; x <= size; x++) {
+         bool border = x == 0 || y == 0 || x == size || y == size;
+         bool grid   = x % 4 == 0 || y % 4 == 0;
+         if (border || (grid && chance(random) < density)) {
+            walls.emplace_back(x, y);
+         }
+      }
+   }
+   return walls;
+}
+
+// Counts failed checks, the test exits with the count so any failure fails the test
+inline int failures = 0;
+
+inline void check(bool condition, const std::string& message) {
+   if (!condition) {
+      std::cerr << "FAILED: " << message << std::endl;
+      failures++;
+   }
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include "TypeRegistries.h"
+
+// Type queries through TypeRegistries (what World::getAll / getFirst use) against the dynamic_cast scans over every
+// object they replaced, at growing object counts. Not a test, run it by hand (in a release build) after changing the
+// registries.
+
+// Stand-ins for the game object classes, as deep as the real ones
+struct Object {
+   virtual ~Object() = default;
+};
+struct Square : Object {};
+struct Tile : Square {};
+struct Character : Square {};
+struct Player : Character {};
+struct Enemy : Character {};
+struct Bomb : Square {};
+
+// Mostly tiles, a few enemies and bombs, and one player halfway through
+std::vector<std::shared_ptr<Object>> makeObjects(size_t count, std::mt19937& random) {
+   std::vector<std::shared_ptr<Object>> objects;
+   std::uniform_int_distribution<int>   kind(0, 99);
+   for (size_t i = 0; i < count; i++) {
+      if (i == count / 2) {
+         objects.push_back(std::make_shared<Player>());
+         continue;
+      }
+      int k = kind(random);
+      if (k < 90) {
+         objects.push_back(std::make_shared<Tile>());
+      } else if (k < 95) {
+         objects.push_back(std::make_shared<Enemy>());
+      } else {
+         objects.push_back(std::make_shared<Bomb>());
+      }
+   }
+   return objects;
+}
+
+// Best of a few runs, in microseconds per call
+template <typename F>
+double timeUs(int calls, F call) {
+   double best = std::numeric_limits<double>::infinity();
+   for (int run = 0; run < 5; run++) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < calls; i++) {
+         call();
+      }
+      std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+      best                                              = std::min(best, elapsed.count() / calls);
+   }
+   return best;
+}
+
+// Found objects are counted and printed so the queries can't be optimized away
+size_t found = 0;
+
+template <typename T>
+std::vector<T*> getAllRegistry(TypeRegistries<Object>& registries, const std::vector<std::shared_ptr<Object>>& all) {
+   auto&           objects = registries.of<T>(all);
+   std::vector<T*> result;
+   result.reserve(objects.size());
+   for (auto& object : objects) {
+      result.push_back(static_cast<T*>(object.get()));
+   }
+   return result;
+}
+
+template <typename T>
+std::vector<T*> getAllScan(const std::vector<std::shared_ptr<Object>>& all) {
+   std::vector<T*> result;
+   for (auto& object : all) {
+      if (auto cast = dynamic_cast<T*>(object.get())) {
+         result.push_back(cast);
+      }
+   }
+   return result;
+}
+
+template <typename T>
+T* getFirstScan(const std::vector<std::shared_ptr<Object>>& all) {
+   for (auto& object : all) {
+      if (auto cast = dynamic_cast<T*>(object.get())) {
+         return cast;
+      }
+   }
+   return nullptr;
+}
+
+void compare(size_t count, std::mt19937& random) {
+   auto objects = makeObjects(count, random);
+   int  calls   = static_cast<int>(std::max<size_t>(1, 1000000 / count));
+
+   // Adding every object with the queried types registered, which is what the registries cost in exchange
+   TypeRegistries<Object> registries;
+   double                 addUs = timeUs(1, [&] {
+      registries = {};
+      registries.of<Tile>({});
+      registries.of<Enemy>({});
+      registries.of<Player>({});
+      for (auto& object : objects) {
+         registries.add(object);
+      }
+   });
+
+   double allRegistry   = timeUs(calls, [&] { found += getAllRegistry<Tile>(registries, objects).size(); });
+   double allScan       = timeUs(calls, [&] { found += getAllScan<Tile>(objects).size(); });
+   double rareRegistry  = timeUs(calls, [&] { found += getAllRegistry<Enemy>(registries, objects).size(); });
+   double rareScan      = timeUs(calls, [&] { found += getAllScan<Enemy>(objects).size(); });
+   double firstRegistry = timeUs(calls * 100, [&] {
+      auto& players  = registries.of<Player>(objects);
+      found         += !players.empty() && players.front() != nullptr;
+   });
+   double firstScan     = timeUs(calls, [&] { found += getFirstScan<Player>(objects) != nullptr; });
+
+   std::cout << count << " objects (" << std::fixed << std::setprecision(3) << addUs * 1000.0 / count
+             << " ns per object to add)\n"
+             << "   getAll<Tile>:    " << std::setw(12) << allRegistry << " us registry, " << std::setw(12) << allScan
+             << " us scan\n"
+             << "   getAll<Enemy>:   " << std::setw(12) << rareRegistry << " us registry, " << std::setw(12)
+             << rareScan << " us scan\n"
+             << "   getFirst<Player>:" << std::setw(12) << firstRegistry << " us registry, " << std::setw(12)
+             << firstScan << " us scan\n";
+}
+
+int main() {
+   std::mt19937 random(5);
+   for (size_t count : {1000, 10000, 100000, 1000000}) {
+      compare(count, random);
+   }
+   std::cout << "(" << found << " found)" << std::endl;
+   return 0;
+}
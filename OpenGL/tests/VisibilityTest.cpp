@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/GeometryUtils.h"
+#include "geometry/WallChunks.h"
+
+using namespace GeometryUtils;
+
+struct Layout {
+   std::string                    name;
+   std::unordered_set<glm::ivec2> wallTiles;
+   WallChunks                     chunks;
+   glm::vec2                      min;
+   glm::vec2                      max;
+};
+
+bool inWall(const Layout& layout, glm::vec2 point) {
+   return layout.wallTiles.contains(glm::ivec2(glm::round(point)));
+}
+
+// Whether the point is in open space enclosed by the walls, where visibility polygons are defined, and not right on a
+// wall (the player can't get that close)
+bool enclosed(const Layout& layout, glm::vec2 point) {
+   for (glm::vec2 corner : {glm::vec2{-1, -1}, glm::vec2{1, -1}, glm::vec2{1, 1}, glm::vec2{-1, 1}}) {
+      if (inWall(layout, point + corner * 0.1f)) {
+         return false;
+      }
+   }
+   const auto& outlines = layout.chunks.result().flattened;
+   return std::any_of(outlines.begin(), outlines.end(), [&](const PathD& path) {
+      return Area(path) > 0 && PointInPolygon({point.x, point.y}, path) == PointInPolygonResult::IsInside;
+   });
+}
+
+std::string describe(const Layout& layout, glm::vec2 position) {
+   return layout.name + " at (" + std::to_string(position.x) + ", " + std::to_string(position.y) + ")";
+}
+
+// In general position the sweep has to see the same region as the ray casting reference it replaced
+void checkAgainstReference(const Layout& layout, glm::vec2 position) {
+   const auto& walls     = layout.chunks.result();
+   PathD       sweep     = ComputeVisibilityPolygon(position, walls.bvh.segments);
+   PathD       reference = ComputeVisibilityPolygonReference(position, walls.flattened, walls.bvh);
+
+   double area       = std::abs(Area(reference));
+   double difference = std::abs(Area(Xor({sweep}, {reference}, FillRule::NonZero)));
+   check(area > 0 && difference < 0.001 * area + 0.01,
+         describe(layout, position) + ": differs from the reference by " + std::to_string(difference) + " of " +
+            std::to_string(area));
+}
+
+// Positions lined up with wall corners are where the sweep has to group events at the same angle and skip sides seen
+// edge-on. The reference casts rays that graze those corners and isn't reliable there, so the polygon is checked
+// against direct line of sight to points around the position instead.
+void checkLineOfSight(const Layout& layout, glm::vec2 position) {
+   const auto& walls = layout.chunks.result();
+   PathD       sweep = ComputeVisibilityPolygon(position, walls.bvh.segments);
+
+   size_t samples    = 0;
+   size_t mismatches = 0;
+   for (float y = position.y - 8.0f + 0.0371f; y < position.y + 8.0f; y += 0.2f) {
+      for (float x = position.x - 8.0f + 0.0137f; x < position.x + 8.0f; x += 0.2f) {
+         glm::vec2 point(x, y);
+         if (inWall(layout, point) || !enclosed(layout, point)) {
+            continue;
+         }
+         bool visible = !walls.bvh.segment_intersect(Segment{position, point}).has_value();
+         bool inside  = PointInPolygon({x, y}, sweep) == PointInPolygonResult::IsInside;
+         samples++;
+         mismatches += visible != inside;
+      }
+   }
+   // Points within float rounding of a shadow edge can go either way
+   check(mismatches * 500 <= samples, describe(layout, position) + ": " + std::to_string(mismatches) + " of " +
+                                         std::to_string(samples) + " points disagree with line of sight");
+}
+
+int main() {
+   std::mt19937 random(2024);
+
+   std::vector<std::unique_ptr<Layout>> layouts;
+   auto add = [&](std::string name, const std::vector<glm::ivec2>& walls) {
+      if (walls.empty()) {
+         return;
+      }
+      auto layout  = std::make_unique<Layout>();
+      layout->name = std::move(name);
+      layout->min  = glm::vec2(std::numeric_limits<float>::max());
+      layout->max  = glm::vec2(std::numeric_limits<float>::lowest());
+      for (auto wall : walls) {
+         layout->wallTiles.insert(wall);
+         layout->chunks.setWall(wall, true);
+         layout->min = glm::min(layout->min, glm::vec2(wall));
+         layout->max = glm::max(layout->max, glm::vec2(wall));
+      }
+      layout->chunks.assemble();
+      layouts.push_back(std::move(layout));
+   };
+   for (const auto& map : mapFiles()) {
+      add(map.filename().string(), loadWalls(map));
+   }
+   for (int i = 0; i < 20; i++) {
+      add("random maze " + std::to_string(i), randomWalls(random, 2 + i % 10, 0.5f));
+   }
+
+   for (const auto& layout : layouts) {
+      std::uniform_real_distribution<float> x(layout->min.x, layout->max.x);
+      std::uniform_real_distribution<float> y(layout->min.y, layout->max.y);
+      std::uniform_int_distribution<int>    tileX(static_cast<int>(layout->min.x), static_cast<int>(layout->max.x));
+      std::uniform_int_distribution<int>    tileY(static_cast<int>(layout->min.y), static_cast<int>(layout->max.y));
+
+      // Away from the lines through tile sides, nothing is seen edge-on and corners rarely share an angle
+      auto general = [](float value) { return std::abs(value - std::floor(value) - 0.5f) > 0.01f; };
+
+      int reference = 0;
+      int aligned   = 0;
+      for (int attempt = 0; attempt < 4000 && (reference < 100 || aligned < 30); attempt++) {
+         if (attempt % 2 == 0) {
+            glm::vec2 position(x(random), y(random));
+            if (reference < 100 && general(position.x) && general(position.y) && enclosed(*layout, position)) {
+               checkAgainstReference(*layout, position);
+               reference++;
+            }
+            continue;
+         }
+
+         // Tile centres, where many corners are at the same angle, and points on the lines through tile sides
+         glm::vec2 position;
+         switch (attempt / 2 % 3) {
+         case 0: position = glm::vec2(tileX(random), tileY(random)); break;
+         case 1: position = {tileX(random) + 0.5f, y(random)}; break;
+         default: position = {x(random), tileY(random) + 0.5f}; break;
+         }
+         if (aligned < 30 && enclosed(*layout, position)) {
+            checkLineOfSight(*layout, position);
+            aligned++;
+         }
+      }
+      check(reference > 0 && aligned > 0, layout->name + ": no open space to test in");
+   }
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}
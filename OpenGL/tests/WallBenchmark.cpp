@@ -0,0 +1,150 @@
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/GeometryUtils.h"
+#include "geometry/SceneGeometry.h"
+#include "geometry/WallChunks.h"
+
+using namespace GeometryUtils;
+
+// Cost of turning wall tiles into wall outlines, and of a bomb blowing up a few of them, on the shipped maps and on
+// large random mazes. Not a test, run it by hand (in a release build) after changing the wall union or WallChunks.
+
+// Best of a few runs, in milliseconds
+template <typename F>
+double timeMs(int runs, F run) {
+   double best = std::numeric_limits<double>::infinity();
+   for (int i = 0; i < runs; i++) {
+      auto start = std::chrono::steady_clock::now();
+      run();
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      best                                              = std::min(best, elapsed.count());
+   }
+   return best;
+}
+
+// Outline points are counted and printed so the unions can't be optimized away
+size_t points = 0;
+
+// The grid union against the Clipper union of the tile squares and the simplification it needed, each followed by
+// the flattening the walls go through
+void compareUnions(const std::string& name, const std::vector<glm::ivec2>& walls) {
+   std::vector<std::vector<glm::vec2>> squares;
+   for (auto wall : walls) {
+      glm::vec2 center(wall);
+      squares.push_back({center + glm::vec2{-0.5, -0.5}, center + glm::vec2{0.5, -0.5}, center + glm::vec2{0.5, 0.5},
+                         center + glm::vec2{-0.5, 0.5}});
+   }
+   auto count = [](const PathsD& paths) {
+      for (const auto& path : paths) {
+         points += path.size();
+      }
+   };
+
+   double gridMs = timeMs(5, [&] {
+      PolyTreeD tree;
+      findGridUnion(walls, tree);
+      count(FlattenPolyPathD(tree, false));
+   });
+   double clipperMs = timeMs(5, [&] {
+      PolyTreeD tree;
+      findPolygonUnion(squares, tree);
+      count(FlattenPolyPathD(tree));
+   });
+
+   std::cout << name << ": " << walls.size() << " walls\n"
+             << std::fixed << std::setprecision(2) << "   grid union:    " << std::setw(9) << gridMs << " ms\n"
+             << "   Clipper union: " << std::setw(9) << clipperMs << " ms (" << clipperMs / gridMs << "x)\n";
+}
+
+// Fog::Mesh's triangulation (without the upload), which the wall mesh goes through for every chunk after a wall change
+size_t triangulate(const PolyPathD& tree) {
+   size_t indices = 0;
+   for (auto& region : tree) {
+      std::vector<std::vector<PointD>> polygon = {region->Polygon()};
+      for (auto& hole : *region) {
+         polygon.push_back(hole->Polygon());
+         indices += triangulate(*hole);
+      }
+      indices += mapbox::earcut<uint32_t>(polygon).size();
+   }
+   return indices;
+}
+
+// One frame of a bomb going off (Bomb::explode) somewhere in the walls: the walls less than 3 steps away are removed,
+// the chunks they were in rebuilt, and the fog derives the open area and the wall mesh from the result
+void timeExplosions(const std::string& name, const std::vector<glm::ivec2>& walls, std::mt19937& random) {
+   WallChunks chunks;
+   for (auto wall : walls) {
+      chunks.setWall(wall, true);
+   }
+   chunks.assemble();
+
+   constexpr int                         explosions = 20;
+   std::uniform_int_distribution<size_t> pick(0, walls.size() - 1);
+   double                                wallsMs = 0.0;
+   double                                openMs  = 0.0;
+   double                                meshMs  = 0.0;
+   for (int i = 0; i < explosions; i++) {
+      glm::ivec2 center = walls[pick(random)];
+      wallsMs += timeMs(1, [&] {
+         for (int dx = -2; dx <= 2; dx++) {
+            for (int dy = std::abs(dx) - 2; dy <= 2 - std::abs(dx); dy++) {
+               chunks.setWall(center + glm::ivec2(dx, dy), false);
+            }
+         }
+         chunks.assemble();
+      });
+      const auto& result = chunks.result();
+      openMs += timeMs(1, [&] {
+         for (const auto& path : SceneGeometry::computeOpenArea(result).flattened) {
+            points += path.size();
+         }
+      });
+      meshMs += timeMs(1, [&] {
+         for (const auto* tree : result.wallPaths) {
+            points += triangulate(*tree);
+         }
+      });
+   }
+
+   std::cout << name << ": " << walls.size() << " walls\n"
+             << std::fixed << std::setprecision(3) << "   walls:     " << std::setw(9) << wallsMs / explosions
+             << " ms (setWall + assemble)\n"
+             << "   open area: " << std::setw(9) << openMs / explosions << " ms (SceneGeometry::computeOpenArea)\n"
+             << "   wall mesh: " << std::setw(9) << meshMs / explosions << " ms (triangulating every chunk)\n";
+}
+
+int main() {
+   std::mt19937 random(3);
+
+   std::cout << "Grid union against the Clipper union of every wall\n";
+   for (const auto& map : mapFiles()) {
+      auto walls = loadWalls(map);
+      if (!walls.empty()) {
+         compareUnions(map.filename().string(), walls);
+      }
+   }
+   for (int rooms : {25, 50, 100}) {
+      compareUnions("maze of " + std::to_string(rooms * rooms) + " rooms", randomWalls(random, rooms, 0.5f));
+   }
+
+   // The same number of explosions on maps of 16x16 up to 256x256 tiles, which should cost about the same
+   std::cout << "\nOne explosion per frame\n";
+   for (const auto& map : mapFiles()) {
+      auto walls = loadWalls(map);
+      if (!walls.empty()) {
+         timeExplosions(map.filename().string(), walls, random);
+      }
+   }
+   for (int rooms : {4, 16, 64}) {
+      int size = rooms * 4;
+      timeExplosions(std::to_string(size) + "x" + std::to_string(size) + " maze", randomWalls(random, rooms, 0.5f),
+                     random);
+   }
+
+   std::cout << "(" << points << " points)" << std::endl;
+   return 0;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "TestMaps.h"
+#include "geometry/GeometryUtils.h"
+#include "geometry/WallChunks.h"
+
+using namespace GeometryUtils;
+
+// Loops in a fixed order, each starting at its smallest point, so outlines traced in a different order compare equal
+std::vector<PathD> canonicalLoops(const PathsD& paths) {
+   auto less = [](const PointD& a, const PointD& b) { return a.x != b.x ? a.x < b.x : a.y < b.y; };
+   std::vector<PathD> loops;
+   for (auto path : paths) {
+      if (path.empty()) {
+         continue;
+      }
+      std::rotate(path.begin(), std::min_element(path.begin(), path.end(), less), path.end());
+      loops.push_back(std::move(path));
+   }
+   std::sort(loops.begin(), loops.end(), [&](const PathD& a, const PathD& b) {
+      return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+   });
+   return loops;
+}
+
+// Segments reachable from the root, i.e. the ones queries can hit
+size_t reachableSegments(const BVH& bvh) {
+   if (bvh.nodes.empty()) {
+      return 0;
+   }
+   size_t              count = 0;
+   std::vector<size_t> stack = {bvh.nodes.size() - 1};
+   while (!stack.empty()) {
+      const BvhNode& node = bvh.nodes[stack.back()];
+      stack.pop_back();
+      for (auto [type, childCount, offset, used] :
+           {std::tuple(node.getLeftType(), node.getLeftCount(), node.leftOffset, true),
+            std::tuple(node.getRightType(), node.getRightCount(), node.rightOffset,
+                       node.rightBBox != glm::vec4(0.0f))}) {
+         if (!used) {
+            continue;
+         }
+         if (type == 1) {
+            count += childCount;
+         } else {
+            stack.push_back(offset);
+         }
+      }
+   }
+   return count;
+}
+
+// Walls patched incrementally have to match walls built from scratch
+void checkAgainstRebuild(const WallChunks& chunks, const std::vector<glm::ivec2>& walls, std::mt19937& random,
+                         const std::string& name) {
+   WallChunks rebuilt;
+   for (auto wall : walls) {
+      rebuilt.setWall(wall, true);
+   }
+   const auto& expected = rebuilt.assemble();
+   const auto& actual   = chunks.result();
+
+   check(canonicalLoops(actual.flattened) == canonicalLoops(expected.flattened), name + ": outlines differ");
+   check(std::abs(Area(actual.flattened) - static_cast<double>(walls.size())) < 1e-6, name + ": outline area");
+   check(actual.wallPaths.size() == expected.wallPaths.size(), name + ": chunk count");
+   check(reachableSegments(actual.bvh) == reachableSegments(expected.bvh), name + ": segment count");
+   check(actual.bvh.nodes.empty() == walls.empty(), name + ": empty BVH");
+
+   std::uniform_real_distribution<float> coordinate(-8.0f, 72.0f);
+   std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+   for (int i = 0; i < 200; i++) {
+      Ray  ray{{coordinate(random), coordinate(random)}, {0.0f, 0.0f}};
+      auto a        = angle(random);
+      ray.direction = {std::cos(a), std::sin(a)};
+      auto hit      = actual.bvh.ray_intersect(ray);
+      auto want     = expected.bvh.ray_intersect(ray);
+      check(hit.has_value() == want.has_value() &&
+               (!hit || glm::distance(hit->first, ray.origin) == glm::distance(want->first, ray.origin)),
+            name + ": ray hits differ");
+   }
+}
+
+int main() {
+   std::mt19937 random(4321);
+
+   std::vector<std::pair<std::string, std::vector<glm::ivec2>>> starts;
+   for (const auto& map : mapFiles()) {
+      starts.emplace_back(map.filename().string(), loadWalls(map));
+   }
+   for (int i = 0; i < 10; i++) {
+      starts.emplace_back("random maze " + std::to_string(i), randomWalls(random, 4 + i % 12, 0.6f));
+   }
+
+   for (auto& [name, startWalls] : starts) {
+      WallChunks chunks;
+      for (auto wall : startWalls) {
+         chunks.setWall(wall, true);
+      }
+      chunks.assemble();
+      std::unordered_set<glm::ivec2> walls(startWalls.begin(), startWalls.end());
+
+      // Explosions: clear or fill small areas, sometimes next to each other between two assembles
+      std::uniform_int_distribution<int> position(-4, 68);
+      std::uniform_int_distribution<int> radius(0, 3);
+      for (int round = 0; round < 40; round++) {
+         for (int blast = 0; blast < 1 + round % 3; blast++) {
+            glm::ivec2 center(position(random), position(random));
+            int        size = radius(random);
+            bool       fill = random() % 4 == 0;
+            for (int y = -size; y <= size; y++) {
+               for (int x = -size; x <= size; x++) {
+                  glm::ivec2 tile = center + glm::ivec2(x, y);
+                  chunks.setWall(tile, fill);
+                  if (fill) {
+                     walls.insert(tile);
+                  } else {
+                     walls.erase(tile);
+                  }
+               }
+            }
+         }
+         chunks.assemble();
+         checkAgainstRebuild(chunks, {walls.begin(), walls.end()}, random, name + " round " + std::to_string(round));
+      }
+
+      // Everything gone, then back
+      for (auto wall : walls) {
+         chunks.setWall(wall, false);
+      }
+      chunks.assemble();
+      checkAgainstRebuild(chunks, {}, random, name + " cleared");
+      for (auto wall : startWalls) {
+         chunks.setWall(wall, true);
+      }
+      chunks.assemble();
+      checkAgainstRebuild(chunks, startWalls, random, name + " restored");
+   }
+
+   std::cout << failures << " failures" << std::endl;
+   return failures == 0 ? 0 : 1;
+}